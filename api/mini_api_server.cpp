@@ -1,21 +1,1163 @@
-#include <iostream>
+// Local HTTP/1.1 sorting service: one epoll thread owns every socket, a fixed pool of workers parses, sorts and
+// formats responses, and finished responses come back to the event loop through an eventfd. Connections are
+// keep-alive by default (HTTP/1.0 clients opt in with "Connection: keep-alive") and pipelined requests are answered in
+// order, one at a time per connection.
+//
+//   POST /sort?algo=dfs|kahn|parallel|layered|lexi_min|lexi_max&format=json|ndjson|binary|text&layout=0|1
+//        body: "n m" then a compressed CSR or m edge pairs (parse_graph_text). Built graphs are kept in an LRU cache
+//        keyed by a 128-bit hash of the body, so resending the same graph skips parsing and CSR construction, and
+//        results are kept in a ResultCache keyed by the graph fingerprint, so the solver and layout are skipped too.
+//        format=ndjson|binary sends the same fields flat through ResultWriter (output_writer.hpp) for machine consumers.
+//   POST /graphs[?id=NAME]         store the body graph under NAME (default: its content hash) -> 201
+//   GET  /graphs/{id}              current order of a stored graph
+//   POST /graphs/{id}/edges[?order=1]
+//        body: "u v" pairs inserted through IncrementalTopoSolver; edges that would close a cycle are rejected by index,
+//        and "inserted" counts only edges that were not already present (the change in m)
+//   GET  /stats                    graph cache, result cache and store counters
+//
+// Stored graphs are written to --data-dir as binary graphs (binary_format.hpp) after every change and reloaded on
+// first use, so they survive a restart. Linux only (epoll, eventfd, accept4).
+#ifdef __linux__
 
-// Minimal placeholder API server. To enable, compile this file with a socket library
-// and define ENABLE_MINI_API. This is a synchronous mock to demonstrate REST shape.
-#ifdef ENABLE_MINI_API
+#include "binary_format.hpp"
+#include "hash.hpp"
+#include "layout.hpp"
+#include "output_writer.hpp"
+#include "parallel.hpp"
+#include "result_cache.hpp"
+#include "text_parser.hpp"
+#include "toposort.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
-#include "../core/compressed_graph.hpp"
-#include "../core/layout.hpp"
-#include "../core/toposort.hpp"
 
-int main() {
-    std::cout << "Mini API stub. In production, use Drogon/Crow with POST /sort accepting JSON edges." << std::endl;
+namespace {
+using node_t = GraphInterface::node_t;
+using Clock = std::chrono::steady_clock;
+
+// Request line plus headers; anything longer is answered with 431.
+constexpr size_t kMaxHeaderBytes = size_t(64) << 10;
+constexpr size_t kReadChunk = size_t(64) << 10;
+constexpr int kMaxEvents = 256;
+constexpr size_t kMaxIdLength = 64;
+
+struct ServerOptions {
+    std::string bind{"127.0.0.1"};
+    int port{8080};
+    size_t threads{default_worker_count()};
+    std::string data_dir{"graphs"}; // empty: stored graphs live in memory only
+    size_t cache_bytes{size_t(256) << 20};
+    size_t result_cache_bytes{size_t(256) << 20};
+    std::string result_spill_dir; // empty: results are only kept in memory
+    size_t max_body_bytes{size_t(256) << 20};
+    size_t max_nodes{size_t(1) << 26}; // larger "n" headers are refused before any n-sized allocation
+    int idle_timeout_s{30};
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// HTTP messages
+
+struct Request {
+    std::string method;
+    std::string path;
+    std::unordered_map<std::string, std::string> query;
+    std::string body;
+    bool keep_alive{true};
+};
+
+struct Response {
+    int status{200};
+    const char *content_type{"application/json"};
+    std::string body;
+};
+
+const char *reason_phrase(int status) {
+    switch (status) {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 411: return "Length Required";
+    case 413: return "Payload Too Large";
+    case 422: return "Unprocessable Entity";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 505: return "HTTP Version Not Supported";
+    default: return "Unknown";
+    }
+}
+
+std::string serialize(const Response &r, bool keep_alive) {
+    std::string out = "HTTP/1.1 " + std::to_string(r.status) + ' ' + reason_phrase(r.status) + "\r\n";
+    out += "Content-Type: ";
+    out += r.content_type;
+    out += "\r\nContent-Length: " + std::to_string(r.body.size());
+    out += keep_alive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+    out += r.body;
+    return out;
+}
+
+void append_json_string(std::string &out, const std::string &s) {
+    out += '"';
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+Response error_response(int status, const std::string &message) {
+    Response r;
+    r.status = status;
+    r.body = "{\"error\":";
+    append_json_string(r.body, message);
+    r.body += "}";
+    return r;
+}
+
+template <class T>
+void append_json_array(std::string &out, const std::vector<T> &values) {
+    OutputWriter w(out);
+    write_json_array(w, values);
+}
+
+bool iequals(const std::string &a, const char *b) {
+    size_t n = std::strlen(b);
+    if (a.size() != n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string trim(const std::string &s) {
+    size_t b = s.find_first_not_of(" \t");
+    if (b == std::string::npos) return std::string();
+    size_t e = s.find_last_not_of(" \t");
+    return s.substr(b, e - b + 1);
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+std::string url_decode(const std::string &s) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '+') {
+            out += ' ';
+        } else if (s[i] == '%' && i + 2 < s.size() && hex_value(s[i + 1]) >= 0 && hex_value(s[i + 2]) >= 0) {
+            out += static_cast<char>(hex_value(s[i + 1]) * 16 + hex_value(s[i + 2]));
+            i += 2;
+        } else {
+            out += s[i];
+        }
+    }
+    return out;
+}
+
+void parse_query(const std::string &q, std::unordered_map<std::string, std::string> &out) {
+    size_t pos = 0;
+    while (pos <= q.size()) {
+        size_t amp = q.find('&', pos);
+        if (amp == std::string::npos) amp = q.size();
+        std::string pair = q.substr(pos, amp - pos);
+        if (!pair.empty()) {
+            size_t eq = pair.find('=');
+            if (eq == std::string::npos) out[url_decode(pair)] = std::string();
+            else out[url_decode(pair.substr(0, eq))] = url_decode(pair.substr(eq + 1));
+        }
+        pos = amp + 1;
+    }
+}
+
+enum class ParseStatus { kIncomplete, kDone, kError };
+
+// Incremental parser over a connection's input. Re-run after every read until it reports kDone (the request, body
+// included, is then moved out and the bytes consumed) or kError (status and message say what to answer before
+// closing). expect_continue is set once the headers are in and the client waits for "100 Continue".
+struct RequestParser {
+    explicit RequestParser(size_t max_body_bytes) : max_body(max_body_bytes) {}
+
+    size_t max_body;
+    int error_status{0};
+    std::string error;
+    bool expect_continue{false};
+
+    ParseStatus parse(std::string &in, Request &req) {
+        size_t header_end = in.find("\r\n\r\n");
+        if (header_end == std::string::npos) {
+            if (in.size() > kMaxHeaderBytes) return fail(431, "request header too large");
+            return ParseStatus::kIncomplete;
+        }
+        if (header_end > kMaxHeaderBytes) return fail(431, "request header too large");
+
+        size_t line_end = in.find("\r\n");
+        std::string line = in.substr(0, line_end);
+        size_t sp1 = line.find(' ');
+        size_t sp2 = sp1 == std::string::npos ? std::string::npos : line.find(' ', sp1 + 1);
+        if (sp2 == std::string::npos) return fail(400, "malformed request line");
+        std::string version = line.substr(sp2 + 1);
+        if (version != "HTTP/1.1" && version != "HTTP/1.0") return fail(505, "unsupported HTTP version");
+        Request r;
+        r.method = line.substr(0, sp1);
+        std::string target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        r.keep_alive = version == "HTTP/1.1";
+
+        bool has_length = false;
+        size_t length = 0;
+        expect_continue = false;
+        size_t pos = line_end + 2;
+        while (pos < header_end) {
+            size_t eol = in.find("\r\n", pos);
+            std::string h = in.substr(pos, eol - pos);
+            pos = eol + 2;
+            size_t colon = h.find(':');
+            if (colon == std::string::npos) return fail(400, "malformed header");
+            std::string name = h.substr(0, colon);
+            std::string value = trim(h.substr(colon + 1));
+            if (iequals(name, "content-length")) {
+                char *end = nullptr;
+                errno = 0;
+                unsigned long long v = std::strtoull(value.c_str(), &end, 10);
+                if (value.empty() || *end != '\0' || errno != 0) return fail(400, "bad Content-Length");
+                if (v > max_body) return fail(413, "request body too large");
+                has_length = true;
+                length = static_cast<size_t>(v);
+            } else if (iequals(name, "transfer-encoding")) {
+                return fail(501, "Transfer-Encoding is not supported; send Content-Length");
+            } else if (iequals(name, "connection")) {
+                if (iequals(value, "close")) r.keep_alive = false;
+                else if (iequals(value, "keep-alive")) r.keep_alive = true;
+            } else if (iequals(name, "expect")) {
+                expect_continue = iequals(value, "100-continue");
+            }
+        }
+        if (r.method == "POST" && !has_length) return fail(411, "Content-Length required");
+
+        size_t total = header_end + 4 + length;
+        if (in.size() < total) return ParseStatus::kIncomplete;
+        expect_continue = false;
+
+        size_t qmark = target.find('?');
+        r.path = url_decode(target.substr(0, qmark));
+        if (qmark != std::string::npos) parse_query(target.substr(qmark + 1), r.query);
+        r.body.assign(in, header_end + 4, length);
+        in.erase(0, total);
+        req = std::move(r);
+        return ParseStatus::kDone;
+    }
+
+private:
+    ParseStatus fail(int status, const char *message) {
+        error_status = status;
+        error = message;
+        return ParseStatus::kError;
+    }
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Graph cache and store
+
+// 128 bits of content hash plus the length; Hash64 is not collision-resistant against crafted input, which is fine for
+// a local service.
+struct BodyKey {
+    uint64_t h1, h2;
+    size_t size;
+    bool operator==(const BodyKey &o) const { return h1 == o.h1 && h2 == o.h2 && size == o.size; }
+};
+struct BodyKeyHash {
+    size_t operator()(const BodyKey &k) const { return static_cast<size_t>(k.h1); }
+};
+
+BodyKey key_of(const std::string &body) {
+    return {Hash64().update(body.data(), body.size()).finish(),
+            Hash64(0xD6E8FEB86659FD93ull).update(body.data(), body.size()).finish(), body.size()};
+}
+
+// Built graphs by request body, least recently used first out once their footprint passes the byte budget. Entries
+// are published before they are shared, so concurrent solvers read the same immutable CsrView.
+class GraphCache {
+public:
+    explicit GraphCache(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+    std::shared_ptr<const CompressedGraph> find(const BodyKey &key) {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            ++misses_;
+            return nullptr;
+        }
+        ++hits_;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->graph;
+    }
+
+    void insert(const BodyKey &key, std::shared_ptr<const CompressedGraph> g) {
+        size_t bytes = g->dense_bytes() + g->varint_bytes();
+        if (bytes > max_bytes_) return;
+        std::lock_guard<std::mutex> lock(mu_);
+        if (index_.count(key)) return; // another worker built it first
+        lru_.push_front({key, std::move(g), bytes});
+        index_.emplace(key, lru_.begin());
+        bytes_ += bytes;
+        while (bytes_ > max_bytes_) {
+            bytes_ -= lru_.back().bytes;
+            index_.erase(lru_.back().key);
+            lru_.pop_back();
+        }
+    }
+
+    void append_stats(std::string &out) {
+        std::lock_guard<std::mutex> lock(mu_);
+        out += "{\"entries\":" + std::to_string(lru_.size()) + ",\"bytes\":" + std::to_string(bytes_) +
+               ",\"max_bytes\":" + std::to_string(max_bytes_) + ",\"hits\":" + std::to_string(hits_) +
+               ",\"misses\":" + std::to_string(misses_) + "}";
+    }
+
+private:
+    struct Entry {
+        BodyKey key;
+        std::shared_ptr<const CompressedGraph> graph;
+        size_t bytes;
+    };
+
+    std::mutex mu_;
+    size_t max_bytes_;
+    size_t bytes_{0};
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+    std::list<Entry> lru_;
+    std::unordered_map<BodyKey, std::list<Entry>::iterator, BodyKeyHash> index_;
+};
+
+// A graph stored under an id; the solver keeps its order across edge batches. Requests on one graph take mu.
+struct StoredGraph {
+    std::mutex mu;
+    CompressedGraph graph;
+    IncrementalTopoSolver solver{graph};
+};
+
+bool valid_id(const std::string &id) {
+    if (id.empty() || id.size() > kMaxIdLength) return false;
+    for (char c : id) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') return false;
+    }
+    return true;
+}
+
+class GraphStore {
+public:
+    explicit GraphStore(std::string dir) : dir_(std::move(dir)) {}
+
+    bool open(std::string &err) {
+        if (dir_.empty() || ::mkdir(dir_.c_str(), 0755) == 0 || errno == EEXIST) return true;
+        err = "cannot create data directory " + dir_ + ": " + std::strerror(errno);
+        return false;
+    }
+
+    // Registers the graph under id and writes it out. Returns the HTTP status: 201, 409 when the id is taken (in
+    // memory or on disk) or 500 when the file cannot be written.
+    int add(const std::string &id, CsrData csr, std::shared_ptr<StoredGraph> &out, std::string &err) {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (graphs_.count(id) || (!dir_.empty() && ::access(path_of(id).c_str(), F_OK) == 0)) {
+            err = "graph id already exists: " + id;
+            return 409;
+        }
+        auto sg = std::make_shared<StoredGraph>();
+        sg->graph.build_from_csr(std::move(csr));
+        if (!persist(id, *sg, err)) return 500;
+        graphs_.emplace(id, sg);
+        out = std::move(sg);
+        return 201;
+    }
+
+    // nullptr when unknown; graphs written by an earlier run are loaded from the data directory on first use.
+    std::shared_ptr<StoredGraph> find(const std::string &id) {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto it = graphs_.find(id);
+        if (it != graphs_.end()) return it->second;
+        if (dir_.empty()) return nullptr;
+        MappedGraph mapped;
+        std::string err;
+        if (!mapped.open(path_of(id), err, true)) return nullptr;
+        CsrView view = mapped.view();
+        CsrData csr;
+        csr.offsets.assign(view.offsets(), view.offsets() + view.node_count() + 1);
+        csr.neighbors.assign(view.neighbors(), view.neighbors() + view.edge_count());
+        auto sg = std::make_shared<StoredGraph>();
+        sg->graph.build_from_csr(std::move(csr));
+        graphs_.emplace(id, sg);
+        return sg;
+    }
+
+    // Rewrites the file of a stored graph (write to a temp name, then rename). Caller holds sg.mu.
+    bool persist(const std::string &id, const StoredGraph &sg, std::string &err) {
+        if (dir_.empty()) return true;
+        std::string path = path_of(id);
+        std::string tmp = path + ".tmp";
+        if (!write_binary_graph(tmp, sg.graph, binfmt::kDense, err)) return false;
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            std::remove(tmp.c_str());
+            err = "cannot rename " + tmp + " to " + path;
+            return false;
+        }
+        return true;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return graphs_.size();
+    }
+
+private:
+    std::string path_of(const std::string &id) const { return dir_ + "/" + id + ".tsg"; }
+
+    std::mutex mu_;
+    std::string dir_;
+    std::unordered_map<std::string, std::shared_ptr<StoredGraph>> graphs_;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Handlers (run on the worker threads)
+
+class Service {
+public:
+    explicit Service(const ServerOptions &opt)
+        : cache_(opt.cache_bytes), results_(ResultCacheOptions{opt.result_cache_bytes, opt.result_spill_dir}),
+          spill_dir_(opt.result_spill_dir), store_(opt.data_dir), max_nodes_(opt.max_nodes),
+          // Every request worker may be solving at once; each gets its share of the cores instead of all of them.
+          solve_workers_(std::max<size_t>(1, default_worker_count() / std::max<size_t>(1, opt.threads))) {}
+
+    bool open(std::string &err) {
+        if (!spill_dir_.empty() && ::mkdir(spill_dir_.c_str(), 0755) != 0 && errno != EEXIST) {
+            err = "cannot create result spill directory " + spill_dir_ + ": " + std::strerror(errno);
+            return false;
+        }
+        return store_.open(err);
+    }
+
+    Response handle(const Request &req) {
+        try {
+            return route(req);
+        } catch (const std::out_of_range &e) {
+            return error_response(400, e.what());
+        } catch (const std::invalid_argument &e) {
+            return error_response(400, e.what());
+        } catch (const std::bad_alloc &) {
+            return error_response(500, "out of memory");
+        } catch (const std::exception &e) {
+            return error_response(500, e.what());
+        }
+    }
+
+private:
+    Response route(const Request &req) {
+        const std::string &p = req.path;
+        if (p == "/sort") {
+            if (req.method != "POST") return error_response(405, "use POST /sort");
+            return sort(req);
+        }
+        if (p == "/stats") {
+            if (req.method != "GET") return error_response(405, "use GET /stats");
+            return stats();
+        }
+        if (p == "/graphs") {
+            if (req.method != "POST") return error_response(405, "use POST /graphs");
+            return upload(req);
+        }
+        const std::string prefix = "/graphs/";
+        if (p.compare(0, prefix.size(), prefix) == 0) {
+            std::string rest = p.substr(prefix.size());
+            size_t slash = rest.find('/');
+            std::string id = rest.substr(0, slash);
+            if (!valid_id(id)) return error_response(404, "not found");
+            if (slash == std::string::npos) {
+                if (req.method != "GET") return error_response(405, "use GET /graphs/{id}");
+                return show(id);
+            }
+            if (rest.substr(slash) == "/edges") {
+                if (req.method != "POST") return error_response(405, "use POST /graphs/{id}/edges");
+                return insert_edges(id, req);
+            }
+        }
+        return error_response(404, "not found");
+    }
+
+    static std::string param(const Request &req, const char *name, const char *fallback) {
+        auto it = req.query.find(name);
+        return it == req.query.end() || it->second.empty() ? std::string(fallback) : it->second;
+    }
+
+    static bool flag(const Request &req, const char *name) {
+        std::string v = param(req, name, "0");
+        return v == "1" || v == "true";
+    }
+
+    // The header's n sizes every array the parser and builder allocate, so a 12-byte body could ask for gigabytes.
+    // 413 when n is over --max-nodes, 400 when the header does not parse; 0 when the body may be parsed.
+    int check_header(const std::string &body, std::string &err) const {
+        size_t n = 0, m = 0;
+        if (!read_graph_header(body.data(), body.size(), n, m, err)) return 400;
+        if (n > max_nodes_) {
+            err = "graph has " + std::to_string(n) + " nodes; the limit is " + std::to_string(max_nodes_) + " (--max-nodes)";
+            return 413;
+        }
+        return 0;
+    }
+
+    std::shared_ptr<const CompressedGraph> graph_for(const std::string &body, bool &cached, int &status,
+                                                     std::string &err) {
+        BodyKey key = key_of(body);
+        auto g = cache_.find(key);
+        cached = g != nullptr;
+        if (g) return g;
+        status = check_header(body, err);
+        if (status != 0) return nullptr;
+        status = 400;
+        CsrData csr;
+        if (!parse_graph_text(body.data(), body.size(), csr, err, solve_workers_)) return nullptr;
+        auto built = std::make_shared<CompressedGraph>();
+        built->build_from_csr(std::move(csr));
+        built->publish();
+        cache_.insert(key, built);
+        return built;
+    }
+
+    Response sort(const Request &req) {
+        std::string algo = param(req, "algo", "dfs");
+        std::string format = param(req, "format", "json");
+        OutputFormat out_format = OutputFormat::kJson;
+        if (format != "text" && !parse_output_format(format, out_format)) {
+            return error_response(400, "format must be json, ndjson, binary or text");
+        }
+        bool layout = flag(req, "layout");
+
+        bool cached = false;
+        int status = 0;
+        std::string err;
+        auto g = graph_for(req.body, cached, status, err);
+        if (!g) return error_response(status, err);
+        CsrView view = g->published();
+
+        // Layout is only part of the key (and only computed) when it will be sent.
+        LayoutParams params;
+        bool hit = false;
+        auto start = Clock::now();
+        auto result = solve_cached(results_, view, g->fingerprint(), algo,
+                                   layout && format != "text" ? &params : nullptr, &hit, solve_workers_);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        const std::vector<node_t> &order = result->order;
+        bool has_cycle = result->has_cycle;
+
+        Response r;
+        if (format == "text") {
+            if (has_cycle) return error_response(422, "graph has a cycle; topological order does not exist");
+            r.content_type = "text/plain";
+            r.body.reserve(order.size() * 8 + 1);
+            OutputWriter w(r.body);
+            for (size_t i = 0; i < order.size(); ++i) {
+                if (i) w.put(' ');
+                w.put_uint(order[i]);
+            }
+            w.put('\n');
+            w.flush();
+            return r;
+        }
+        ms = std::round(ms * 1000.0) / 1000.0;
+        r.body.reserve(order.size() * (layout ? 72 : 8) + 256);
+        OutputWriter w(r.body);
+        if (out_format != OutputFormat::kJson) {
+            // Flat fields for machine consumers; levels become two arrays.
+            r.content_type = out_format == OutputFormat::kBinary ? "application/octet-stream" : "application/x-ndjson";
+            ResultWriter doc(w, out_format);
+            doc.field("algorithm", algo);
+            doc.field("has_cycle", has_cycle);
+            doc.field("cached", cached);
+            doc.field("result_cached", hit);
+            doc.field("n", view.node_count());
+            doc.field("m", view.edge_count());
+            doc.field("time_ms", ms);
+            if (has_cycle) doc.null("topo");
+            else doc.array("topo", order);
+            if (algo == "layered" && !has_cycle) {
+                doc.array("level_offsets", result->levels.offsets);
+                doc.array("level_nodes", result->levels.nodes);
+            }
+            if (layout && !has_cycle) doc.layout("layout", result->layout);
+            doc.finish();
+            w.flush();
+            return r;
+        }
+        w.put("{\"algorithm\":");
+        w.put_json_string(algo);
+        w.put(",\"has_cycle\":");
+        w.put_bool(has_cycle);
+        w.put(",\"cached\":");
+        w.put_bool(cached);
+        w.put(",\"result_cached\":");
+        w.put_bool(hit);
+        w.put(",\"n\":");
+        w.put_uint(view.node_count());
+        w.put(",\"m\":");
+        w.put_uint(view.edge_count());
+        w.put(",\"time_ms\":");
+        w.put_double(ms);
+        w.put(",\"topo\":");
+        if (has_cycle) w.put("null");
+        else write_json_array(w, order);
+        if (algo == "layered" && !has_cycle) {
+            w.put(",\"levels\":");
+            write_levels_json(w, result->levels);
+        }
+        if (layout && !has_cycle) {
+            w.put(",\"layout\":");
+            write_layout_json(w, result->layout);
+        }
+        w.put('}');
+        w.flush();
+        return r;
+    }
+
+    Response upload(const Request &req) {
+        CsrData csr;
+        std::string err;
+        if (int status = check_header(req.body, err)) return error_response(status, err);
+        if (!parse_graph_text(req.body.data(), req.body.size(), csr, err, solve_workers_)) {
+            return error_response(400, err);
+        }
+        std::string id = param(req, "id", "");
+        if (id.empty()) {
+            char buf[24];
+            std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(key_of(req.body).h1));
+            id = buf;
+            if (auto existing = store_.find(id)) return describe(id, *existing, false, 200);
+        } else if (!valid_id(id)) {
+            return error_response(400, "id must be 1-64 characters of [A-Za-z0-9_-]");
+        }
+        std::shared_ptr<StoredGraph> sg;
+        int status = store_.add(id, std::move(csr), sg, err);
+        if (status != 201) return error_response(status, err);
+        return describe(id, *sg, false, status);
+    }
+
+    Response show(const std::string &id) {
+        auto sg = store_.find(id);
+        if (!sg) return error_response(404, "unknown graph: " + id);
+        return describe(id, *sg, true, 200);
+    }
+
+    Response describe(const std::string &id, StoredGraph &sg, bool with_order, int status) {
+        std::lock_guard<std::mutex> lock(sg.mu);
+        Response r;
+        r.status = status;
+        r.body = "{\"id\":";
+        append_json_string(r.body, id);
+        append_summary(r.body, sg, with_order);
+        r.body += "}";
+        return r;
+    }
+
+    static void append_summary(std::string &out, StoredGraph &sg, bool with_order) {
+        out += ",\"n\":" + std::to_string(sg.graph.node_count()) +
+               ",\"m\":" + std::to_string(sg.graph.snapshot().edge_count());
+        if (!with_order) return;
+        std::vector<node_t> order;
+        bool has_cycle = sg.solver.run(order);
+        out += ",\"has_cycle\":";
+        out += has_cycle ? "true" : "false";
+        out += ",\"topo\":";
+        if (has_cycle) out += "null";
+        else append_json_array(out, order);
+    }
+
+    // "u v" pairs separated by any whitespace.
+    static bool parse_edge_pairs(const std::string &body, std::vector<IncrementalTopoSolver::Edge> &edges,
+                                 std::string &err) {
+        std::vector<uint32_t> ids;
+        size_t i = 0;
+        while (i < body.size()) {
+            char c = body[i];
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                ++i;
+                continue;
+            }
+            if (c < '0' || c > '9') {
+                err = "unexpected character at byte " + std::to_string(i);
+                return false;
+            }
+            uint64_t v = 0;
+            while (i < body.size() && body[i] >= '0' && body[i] <= '9') {
+                v = v * 10 + static_cast<uint64_t>(body[i++] - '0');
+                if (v > UINT32_MAX) {
+                    err = "edge endpoint out of range";
+                    return false;
+                }
+            }
+            ids.push_back(static_cast<uint32_t>(v));
+        }
+        if (ids.size() % 2 != 0) {
+            err = "expected pairs \"u v\"";
+            return false;
+        }
+        edges.clear();
+        for (size_t k = 0; k < ids.size(); k += 2) edges.emplace_back(ids[k], ids[k + 1]);
+        return true;
+    }
+
+    // Distinct in-range edges of a batch that the graph does not have yet. add_edges also accepts edges that already
+    // exist (adjacency is a set), so the accepted count alone overstates the insertions.
+    static std::vector<IncrementalTopoSolver::Edge> absent_edges(const StoredGraph &sg,
+                                                                 const std::vector<IncrementalTopoSolver::Edge> &edges) {
+        size_t n = sg.graph.node_count();
+        std::vector<IncrementalTopoSolver::Edge> absent;
+        for (const auto &e : edges) {
+            if (e.first < n && e.second < n && !sg.graph.has_edge(e.first, e.second)) absent.push_back(e);
+        }
+        std::sort(absent.begin(), absent.end());
+        absent.erase(std::unique(absent.begin(), absent.end()), absent.end());
+        return absent;
+    }
+
+    Response insert_edges(const std::string &id, const Request &req) {
+        std::vector<IncrementalTopoSolver::Edge> edges;
+        std::string err;
+        if (!parse_edge_pairs(req.body, edges, err)) return error_response(400, err);
+        auto sg = store_.find(id);
+        if (!sg) return error_response(404, "unknown graph: " + id);
+
+        std::lock_guard<std::mutex> lock(sg->mu);
+        std::vector<IncrementalTopoSolver::Edge> absent = absent_edges(*sg, edges);
+        std::vector<size_t> rejected;
+        sg->solver.add_edges(edges, rejected); // throws std::out_of_range before inserting anything
+        size_t inserted = 0; // the change in m: edges that were absent and got accepted
+        for (const auto &e : absent) inserted += sg->graph.has_edge(e.first, e.second) ? 1 : 0;
+        if (inserted != 0 && !store_.persist(id, *sg, err)) return error_response(500, err);
+        Response r;
+        r.body = "{\"id\":";
+        append_json_string(r.body, id);
+        r.body += ",\"inserted\":" + std::to_string(inserted) + ",\"rejected\":";
+        append_json_array(r.body, rejected);
+        append_summary(r.body, *sg, flag(req, "order"));
+        r.body += "}";
+        return r;
+    }
+
+    Response stats() {
+        Response r;
+        r.body = "{\"cache\":";
+        cache_.append_stats(r.body);
+        ResultCacheStats rs = results_.stats();
+        r.body += ",\"results\":{\"entries\":" + std::to_string(rs.entries) + ",\"bytes\":" + std::to_string(rs.bytes) +
+                  ",\"hits\":" + std::to_string(rs.hits) + ",\"disk_hits\":" + std::to_string(rs.disk_hits) +
+                  ",\"misses\":" + std::to_string(rs.misses) + ",\"evictions\":" + std::to_string(rs.evictions) +
+                  ",\"spilled\":" + std::to_string(rs.spilled) + "}";
+        r.body += ",\"stored_graphs\":" + std::to_string(store_.size()) + "}";
+        return r;
+    }
+
+    GraphCache cache_;
+    ResultCache results_;
+    std::string spill_dir_;
+    GraphStore store_;
+    size_t max_nodes_;
+    size_t solve_workers_;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Event loop
+
+struct Job {
+    uint64_t conn_id;
+    int fd;
+    Request request;
+};
+
+struct Done {
+    uint64_t conn_id;
+    int fd;
+    std::string bytes;
+    bool keep_alive;
+};
+
+struct Connection {
+    uint64_t id;
+    int fd;
+    std::string in;
+    std::string out;
+    size_t out_off{0};
+    bool busy{false};        // a request is with the workers; the socket is out of epoll meanwhile
+    bool close_after{false}; // close once out is flushed
+    bool continue_sent{false};
+    Clock::time_point last_active{Clock::now()};
+};
+
+std::atomic<bool> g_stop{false};
+
+void on_signal(int) { g_stop.store(true); }
+
+class Server {
+public:
+    explicit Server(const ServerOptions &opt) : opt_(opt), service_(opt) {}
+
+    ~Server() {
+        for (auto &kv : conns_) ::close(kv.first);
+        if (listen_fd_ >= 0) ::close(listen_fd_);
+        if (event_fd_ >= 0) ::close(event_fd_);
+        if (epoll_fd_ >= 0) ::close(epoll_fd_);
+    }
+
+    bool start(std::string &err) {
+        if (!service_.open(err)) return false;
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) return sys_error("socket", err);
+        int one = 1;
+        ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(opt_.port));
+        if (::inet_pton(AF_INET, opt_.bind.c_str(), &addr.sin_addr) != 1) {
+            err = "bad bind address: " + opt_.bind;
+            return false;
+        }
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) return sys_error("bind", err);
+        if (::listen(listen_fd_, SOMAXCONN) != 0) return sys_error("listen", err);
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) return sys_error("epoll_create1", err);
+        event_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (event_fd_ < 0) return sys_error("eventfd", err);
+        watch(listen_fd_, EPOLLIN, EPOLL_CTL_ADD);
+        watch(event_fd_, EPOLLIN, EPOLL_CTL_ADD);
+        return true;
+    }
+
+    void run() {
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < std::max<size_t>(1, opt_.threads); ++i) workers.emplace_back([this] { work(); });
+
+        epoll_event events[kMaxEvents];
+        while (!g_stop.load()) {
+            int ready = ::epoll_wait(epoll_fd_, events, kMaxEvents, 1000);
+            for (int i = 0; i < ready; ++i) {
+                int fd = events[i].data.fd;
+                uint32_t ev = events[i].events;
+                if (fd == listen_fd_) accept_all();
+                else if (fd == event_fd_) collect_done();
+                else on_socket(fd, ev);
+            }
+            close_idle();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(jobs_mu_);
+            stopping_ = true;
+        }
+        jobs_cv_.notify_all();
+        for (auto &t : workers) t.join();
+    }
+
+private:
+    static bool sys_error(const char *what, std::string &err) {
+        err = std::string(what) + ": " + std::strerror(errno);
+        return false;
+    }
+
+    void watch(int fd, uint32_t events, int op) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        ::epoll_ctl(epoll_fd_, op, fd, &ev);
+    }
+
+    void accept_all() {
+        for (;;) {
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return; // EAGAIN, or out of descriptors: retry on the next readiness event
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            auto c = std::make_unique<Connection>();
+            c->id = next_conn_id_++;
+            c->fd = fd;
+            conns_[fd] = std::move(c);
+            watch(fd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD);
+        }
+    }
+
+    void close_conn(int fd) {
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        conns_.erase(fd);
+    }
+
+    void on_socket(int fd, uint32_t ev) {
+        auto it = conns_.find(fd);
+        if (it == conns_.end()) return;
+        Connection &c = *it->second;
+        if (ev & (EPOLLERR | EPOLLHUP)) {
+            close_conn(fd);
+            return;
+        }
+        if (ev & EPOLLOUT) {
+            if (!flush(c)) return;
+        }
+        if (ev & (EPOLLIN | EPOLLRDHUP)) {
+            bool eof = false;
+            char buf[kReadChunk];
+            for (;;) {
+                ssize_t got = ::recv(fd, buf, sizeof(buf), 0);
+                if (got > 0) {
+                    c.in.append(buf, static_cast<size_t>(got));
+                    if (c.in.size() > opt_.max_body_bytes + kMaxHeaderBytes) break; // the parser rejects it below
+                    continue;
+                }
+                if (got == 0) eof = true;
+                else if (errno == EINTR) continue;
+                else if (errno != EAGAIN && errno != EWOULDBLOCK) eof = true;
+                break;
+            }
+            c.last_active = Clock::now();
+            if (eof) {
+                // A half-closed client still gets the answers to requests it finished sending.
+                c.close_after = true;
+                if (!dispatch(c)) return;
+                if (!c.busy && c.out_off == c.out.size()) close_conn(fd);
+                return;
+            }
+            dispatch(c);
+        }
+    }
+
+    // Hands the next complete request to the workers. Returns false if the connection was closed.
+    bool dispatch(Connection &c) {
+        if (c.busy || c.out_off != c.out.size()) return true;
+        RequestParser parser(opt_.max_body_bytes);
+        Request req;
+        ParseStatus st = parser.parse(c.in, req);
+        if (st == ParseStatus::kIncomplete) {
+            if (parser.expect_continue && !c.continue_sent) {
+                c.continue_sent = true;
+                c.out += "HTTP/1.1 100 Continue\r\n\r\n";
+                return flush(c);
+            }
+            return true;
+        }
+        if (st == ParseStatus::kError) {
+            c.in.clear();
+            c.close_after = true;
+            c.out += serialize(error_response(parser.error_status, parser.error), false);
+            return flush(c);
+        }
+        c.continue_sent = false;
+        if (!req.keep_alive) c.close_after = true;
+        c.busy = true;
+        watch(c.fd, 0, EPOLL_CTL_MOD); // only errors until the response is back
+        {
+            std::lock_guard<std::mutex> lock(jobs_mu_);
+            jobs_.push_back(Job{c.id, c.fd, std::move(req)});
+        }
+        jobs_cv_.notify_one();
+        return true;
+    }
+
+    // Writes as much of c.out as the socket takes. Returns false if the connection was closed.
+    bool flush(Connection &c) {
+        while (c.out_off < c.out.size()) {
+            ssize_t put = ::send(c.fd, c.out.data() + c.out_off, c.out.size() - c.out_off, MSG_NOSIGNAL);
+            if (put > 0) {
+                c.out_off += static_cast<size_t>(put);
+                continue;
+            }
+            if (put < 0 && errno == EINTR) continue;
+            if (put < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                // After the peer's EOF, RDHUP would keep firing; only wait for room to write.
+                watch(c.fd, c.close_after ? EPOLLOUT : EPOLLOUT | EPOLLRDHUP, EPOLL_CTL_MOD);
+                return true;
+            }
+            close_conn(c.fd);
+            return false;
+        }
+        c.out.clear();
+        c.out_off = 0;
+        c.last_active = Clock::now();
+        if (c.close_after && !c.busy) {
+            close_conn(c.fd);
+            return false;
+        }
+        if (!c.busy) {
+            watch(c.fd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_MOD);
+            return dispatch(c); // pipelined requests already buffered
+        }
+        return true;
+    }
+
+    void collect_done() {
+        uint64_t ticks;
+        while (::read(event_fd_, &ticks, sizeof(ticks)) > 0) {}
+        std::deque<Done> done;
+        {
+            std::lock_guard<std::mutex> lock(done_mu_);
+            done.swap(done_);
+        }
+        for (Done &d : done) {
+            auto it = conns_.find(d.fd);
+            if (it == conns_.end() || it->second->id != d.conn_id) continue; // closed while the worker ran
+            Connection &c = *it->second;
+            c.busy = false;
+            if (!d.keep_alive) c.close_after = true;
+            c.out += d.bytes;
+            flush(c);
+        }
+    }
+
+    void close_idle() {
+        auto limit = Clock::now() - std::chrono::seconds(opt_.idle_timeout_s);
+        std::vector<int> idle;
+        for (auto &kv : conns_) {
+            const Connection &c = *kv.second;
+            if (!c.busy && c.out.empty() && c.last_active < limit) idle.push_back(kv.first);
+        }
+        for (int fd : idle) close_conn(fd);
+    }
+
+    void work() {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(jobs_mu_);
+                jobs_cv_.wait(lock, [&] { return stopping_ || !jobs_.empty(); });
+                if (jobs_.empty()) return;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            Response r = service_.handle(job.request);
+            Done d{job.conn_id, job.fd, serialize(r, job.request.keep_alive), job.request.keep_alive};
+            {
+                std::lock_guard<std::mutex> lock(done_mu_);
+                done_.push_back(std::move(d));
+            }
+            uint64_t one = 1;
+            ssize_t put = ::write(event_fd_, &one, sizeof(one));
+            (void)put;
+        }
+    }
+
+    ServerOptions opt_;
+    Service service_;
+    int listen_fd_{-1};
+    int epoll_fd_{-1};
+    int event_fd_{-1};
+    uint64_t next_conn_id_{1};
+    std::unordered_map<int, std::unique_ptr<Connection>> conns_; // event-loop thread only
+
+    std::mutex jobs_mu_;
+    std::condition_variable jobs_cv_;
+    std::deque<Job> jobs_;
+    bool stopping_{false};
+
+    std::mutex done_mu_;
+    std::deque<Done> done_;
+};
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: topsort_api [--bind ADDR] [--port P] [--threads N] [--data-dir DIR] [--cache-mb MB]\n"
+                 "                   [--result-cache-mb MB] [--result-spill-dir DIR] [--max-body-mb MB] [--max-nodes N]\n"
+                 "                   [--idle-timeout S]\n");
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    ServerOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--help" || arg == "-h") { usage(); return 0; }
+        if (!val) { usage(); return 2; }
+        if (arg == "--bind") opt.bind = val;
+        else if (arg == "--port") opt.port = std::atoi(val);
+        else if (arg == "--threads") opt.threads = std::strtoull(val, nullptr, 10);
+        else if (arg == "--data-dir") opt.data_dir = val;
+        else if (arg == "--cache-mb") opt.cache_bytes = std::strtoull(val, nullptr, 10) << 20;
+        else if (arg == "--result-cache-mb") opt.result_cache_bytes = std::strtoull(val, nullptr, 10) << 20;
+        else if (arg == "--result-spill-dir") opt.result_spill_dir = val;
+        else if (arg == "--max-body-mb") opt.max_body_bytes = std::strtoull(val, nullptr, 10) << 20;
+        else if (arg == "--max-nodes") opt.max_nodes = std::strtoull(val, nullptr, 10);
+        else if (arg == "--idle-timeout") opt.idle_timeout_s = std::atoi(val);
+        else { usage(); return 2; }
+        ++i;
+    }
+
+    struct sigaction sa{};
+    sa.sa_handler = on_signal;
+    ::sigaction(SIGINT, &sa, nullptr);
+    ::sigaction(SIGTERM, &sa, nullptr);
+    ::signal(SIGPIPE, SIG_IGN);
+
+    Server server(opt);
+    std::string err;
+    if (!server.start(err)) {
+        std::fprintf(stderr, "%s\n", err.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "listening on %s:%d (%zu workers)\n", opt.bind.c_str(), opt.port, opt.threads);
+    server.run();
     return 0;
 }
+
 #else
+
+#include <cstdio>
+
 int main() {
-    std::cout << "ENABLE_MINI_API not defined. Build with -DENABLE_MINI_API to run stub." << std::endl;
-    return 0;
+    std::fprintf(stderr, "topsort_api needs Linux (epoll); not built for this platform.\n");
+    return 1;
 }
+
 #endif
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct BenchOptions {
+    std::string suite{"traversal"};
+    std::string graph{"all"}; // DAG family for the solvers suite (see kDagFamilies in bench_util.hpp)
+    size_t nodes{1000000};
+    size_t edges{8000000};
+    uint64_t seed{42};
+    int reps{3};
+    bool instrument{false}; // solvers suite: add per-phase timers and counters to each line (see instrument.hpp)
+    std::string trace;      // Chrome trace-event file written after the run; implies instrument
+};
+
+// Each suite prints one JSON line per measurement; returns a process exit code.
+int run_traversal_bench(const BenchOptions &opt);
+int run_parse_bench(const BenchOptions &opt);
+int run_varint_bench(const BenchOptions &opt);
+int run_reorder_bench(const BenchOptions &opt);
+int run_incremental_bench(const BenchOptions &opt);
+int run_schedule_bench(const BenchOptions &opt);
+int run_solvers_bench(const BenchOptions &opt);
+int run_output_bench(const BenchOptions &opt);
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "compressed_graph.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+using bench_node_t = GraphInterface::node_t;
+using EdgeList = std::vector<std::pair<bench_node_t, bench_node_t>>;
+
+class BenchTimer {
+public:
+    BenchTimer() : start_(std::chrono::steady_clock::now()) {}
+    double ms() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+    }
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Keep a value observable so the optimizer cannot drop the loop that produced it.
+template <class T>
+inline void keep_alive(const T &v) {
+    static volatile T sink;
+    sink = v;
+    (void)sink;
+}
+
+// m edges between positions drawn by pick(rng, a, b), oriented from the lower to the higher position and then mapped
+// through a hidden random relabeling, so ids carry no order information. Equal positions are redrawn.
+template <class Pick>
+EdgeList dag_from_positions(size_t n, size_t m, uint64_t seed, Pick &&pick) {
+    std::mt19937_64 rng(seed);
+    std::vector<bench_node_t> perm(n);
+    for (size_t i = 0; i < n; ++i) perm[i] = static_cast<bench_node_t>(i);
+    std::shuffle(perm.begin(), perm.end(), rng);
+    EdgeList edges;
+    edges.reserve(m);
+    if (n < 2) return edges;
+    while (edges.size() < m) {
+        size_t a, b;
+        pick(rng, a, b);
+        if (a == b) continue;
+        if (a > b) std::swap(a, b);
+        edges.emplace_back(perm[a], perm[b]);
+    }
+    return edges;
+}
+
+// Random DAG: uniform position pairs.
+inline EdgeList random_dag_edges(size_t n, size_t m, uint64_t seed) {
+    std::uniform_int_distribution<size_t> pos(0, n == 0 ? 0 : n - 1);
+    return dag_from_positions(n, m, seed, [&](std::mt19937_64 &rng, size_t &a, size_t &b) {
+        a = pos(rng);
+        b = pos(rng);
+    });
+}
+
+// About sqrt(n) layers of sqrt(n) nodes; every edge joins a node to one in the next layer, so there are that many
+// Kahn levels, each as wide as a layer.
+inline EdgeList layered_dag_edges(size_t n, size_t m, uint64_t seed) {
+    size_t width = std::max<size_t>(1, static_cast<size_t>(std::sqrt(static_cast<double>(n))));
+    size_t last = n > width ? n - width : 1;
+    return dag_from_positions(n, m, seed, [&](std::mt19937_64 &rng, size_t &a, size_t &b) {
+        a = rng() % last;
+        b = std::min(n - 1, (a / width + 1) * width + rng() % width);
+    });
+}
+
+// One path through all n nodes (n - 1 levels, the DFS worst case for stack depth), then short forward skips of at
+// most 8 positions for the remaining edges.
+inline EdgeList chain_dag_edges(size_t n, size_t m, uint64_t seed) {
+    size_t next = 0;
+    return dag_from_positions(n, m, seed, [&](std::mt19937_64 &rng, size_t &a, size_t &b) {
+        if (next + 1 < n) {
+            a = next++;
+            b = a + 1;
+            return;
+        }
+        a = rng() % (n - 1);
+        b = std::min(n - 1, a + 1 + rng() % 8);
+    });
+}
+
+// n / 1024 hub sources (at least one) that own every edge: one very wide level right after the sources.
+inline EdgeList fanout_dag_edges(size_t n, size_t m, uint64_t seed) {
+    size_t hubs = std::max<size_t>(1, n / 1024);
+    return dag_from_positions(n, m, seed, [&](std::mt19937_64 &rng, size_t &a, size_t &b) {
+        a = rng() % hubs;
+        b = hubs < n ? hubs + rng() % (n - hubs) : a;
+    });
+}
+
+// Skewed endpoints: a position is n * x^3 for uniform x, so low positions are hubs and degrees follow a power law.
+inline EdgeList power_law_dag_edges(size_t n, size_t m, uint64_t seed) {
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    auto skewed = [&](std::mt19937_64 &rng) {
+        double x = unit(rng);
+        return std::min(n - 1, static_cast<size_t>(static_cast<double>(n) * x * x * x));
+    };
+    return dag_from_positions(n, m, seed, [&](std::mt19937_64 &rng, size_t &a, size_t &b) {
+        a = skewed(rng);
+        b = skewed(rng);
+    });
+}
+
+// Generator families by --graph name.
+inline const char *const kDagFamilies[] = {"random", "layered", "chain", "fanout", "powerlaw"};
+
+inline bool generate_dag_edges(const std::string &family, size_t n, size_t m, uint64_t seed, EdgeList &out) {
+    if (family == "random") out = random_dag_edges(n, m, seed);
+    else if (family == "layered") out = layered_dag_edges(n, m, seed);
+    else if (family == "chain") out = chain_dag_edges(n, m, seed);
+    else if (family == "fanout") out = fanout_dag_edges(n, m, seed);
+    else if (family == "powerlaw") out = power_law_dag_edges(n, m, seed);
+    else return false;
+    return true;
+}
+
+// Peak resident set size of the process so far, in KiB (0 where the platform does not report it).
+inline size_t peak_rss_kb() {
+#if defined(__APPLE__)
+    struct rusage ru;
+    return getrusage(RUSAGE_SELF, &ru) == 0 ? static_cast<size_t>(ru.ru_maxrss) / 1024 : 0; // bytes on macOS
+#elif !defined(_WIN32)
+    struct rusage ru;
+    return getrusage(RUSAGE_SELF, &ru) == 0 ? static_cast<size_t>(ru.ru_maxrss) : 0;
+#else
+    return 0;
+#endif
+}
+
+// Edges stored after dedup (the generators may emit duplicates).
+inline size_t edge_count(const GraphInterface &g) {
+    size_t m = 0;
+    for (bench_node_t u = 0; u < g.node_count(); ++u) {
+        auto span = g.neighbor_span(u);
+        m += static_cast<size_t>(span.second - span.first);
+    }
+    return m;
+}
+
+// One JSON object per measurement so results can be collected with line-oriented tools.
+inline void report(const std::string &suite, const std::string &variant, size_t n, size_t m, double ms) {
+    double ns_per_edge = m == 0 ? 0.0 : ms * 1e6 / static_cast<double>(m);
+    std::printf("{\"suite\":\"%s\",\"variant\":\"%s\",\"n\":%zu,\"m\":%zu,\"ms\":%.3f,\"ns_per_edge\":%.3f}\n",
+                suite.c_str(), variant.c_str(), n, m, ms, ns_per_edge);
+}
+
+inline void report_throughput(const std::string &suite, const std::string &variant, size_t bytes, double ms) {
+    double mb_per_s = ms <= 0.0 ? 0.0 : static_cast<double>(bytes) / (1024.0 * 1024.0) / (ms / 1000.0);
+    std::printf("{\"suite\":\"%s\",\"variant\":\"%s\",\"bytes\":%zu,\"ms\":%.3f,\"mb_per_s\":%.1f}\n",
+                suite.c_str(), variant.c_str(), bytes, ms, mb_per_s);
+}
+
+// Storage footprint of one representation.
+inline void report_bytes(const std::string &suite, const std::string &variant, size_t n, size_t m, size_t bytes) {
+    double per_edge = m == 0 ? 0.0 : static_cast<double>(bytes) / static_cast<double>(m);
+    std::printf("{\"suite\":\"%s\",\"variant\":\"%s\",\"n\":%zu,\"m\":%zu,\"bytes\":%zu,\"bytes_per_edge\":%.3f}\n",
+                suite.c_str(), variant.c_str(), n, m, bytes, per_edge);
+}
@@ -0,0 +1,103 @@
+#include "bench_suites.hpp"
+#include "bench_util.hpp"
+
+#include "toposort.hpp"
+
+namespace {
+constexpr size_t kLocalUpdates = 10000;
+constexpr size_t kRandomUpdates = 1000; // each can move a large part of the order
+constexpr size_t kBatchSize = 1000;
+constexpr size_t kLocalSpan = 64;
+constexpr size_t kMixedReads = 16;
+constexpr size_t kCompactEachUpdates = 100; // each costs a full O(n + m) rebuild
+
+// "local": backward edges between nodes at most kLocalSpan apart in the current order (the common case of a small
+// dependency change); "random": uniformly random pairs, which mostly span long windows.
+EdgeList update_stream(const std::vector<bench_node_t> &order, bool local, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    size_t n = order.size();
+    EdgeList edges;
+    if (n < 2) return edges;
+    size_t count = local ? kLocalUpdates : kRandomUpdates;
+    edges.reserve(count);
+    while (edges.size() < count) {
+        size_t i = rng() % n;
+        size_t j = local ? i + 1 + rng() % kLocalSpan : rng() % n;
+        if (j >= n || i == j) continue;
+        edges.emplace_back(order[j], order[i]);
+    }
+    return edges;
+}
+
+// Interleave single inserts with reads of kMixedReads random rows: "overlay" reads the live graph, "compact_each"
+// folds every insert into a fresh CSR before reading (what a rebuild-on-read store pays), "read_only" skips the inserts.
+void run_mixed(const BenchOptions &opt, const EdgeList &base, const EdgeList &updates) {
+    std::mt19937_64 rng(opt.seed + 2);
+    std::vector<bench_node_t> rows(updates.size() * kMixedReads);
+    for (auto &r : rows) r = static_cast<bench_node_t>(rng() % opt.nodes);
+    for (int rep = 0; rep < opt.reps; ++rep) {
+        for (const char *mode : {"read_only", "overlay", "compact_each"}) {
+            std::string variant = mode;
+            CompressedGraph g;
+            g.build_from_edges(opt.nodes, base);
+            size_t updates_run = variant == "compact_each" ? std::min(updates.size(), kCompactEachUpdates) : updates.size();
+            uint64_t sum = 0;
+            BenchTimer t;
+            for (size_t i = 0; i < updates_run; ++i) {
+                if (variant != "read_only") g.add_edge(updates[i].first, updates[i].second);
+                if (variant == "compact_each") g.compact();
+                for (size_t k = i * kMixedReads; k < (i + 1) * kMixedReads; ++k) {
+                    g.for_each_neighbor(rows[k], [&](bench_node_t v) { sum += v; });
+                }
+            }
+            report("incremental", "mixed/" + variant, opt.nodes, updates_run, t.ms());
+            keep_alive(sum);
+        }
+    }
+}
+}
+
+// Per-update latency of IncrementalTopoSolver (single add_edge and batched add_edges) against recomputing from scratch
+// with KahnTopoSolver after every update. In this suite "m" is the number of updates and ns_per_edge is per update.
+int run_incremental_bench(const BenchOptions &opt) {
+    EdgeList base = random_dag_edges(opt.nodes, opt.edges, opt.seed);
+    std::vector<bench_node_t> order;
+    {
+        CompressedGraph g;
+        g.build_from_edges(opt.nodes, base);
+        for (int rep = 0; rep < opt.reps; ++rep) {
+            BenchTimer t;
+            KahnTopoSolver(g).run(order);
+            report("incremental", "kahn/full_recompute", opt.nodes, 1, t.ms());
+        }
+    }
+
+    run_mixed(opt, base, update_stream(order, true, opt.seed + 1));
+
+    for (bool local : {true, false}) {
+        std::string stream = local ? "local" : "random";
+        EdgeList updates = update_stream(order, local, opt.seed + 1);
+        for (int rep = 0; rep < opt.reps; ++rep) {
+            for (size_t batch : {size_t{1}, kBatchSize}) {
+                CompressedGraph g;
+                g.build_from_edges(opt.nodes, base);
+                IncrementalTopoSolver inc(g);
+                std::vector<bench_node_t> scratch;
+                inc.run(scratch); // initial order and reverse adjacency, also outside the timer
+
+                std::vector<size_t> rejected;
+                size_t rejected_total = 0;
+                BenchTimer t;
+                for (size_t i = 0; i < updates.size(); i += batch) {
+                    size_t count = std::min(batch, updates.size() - i);
+                    inc.add_edges(updates.data() + i, count, rejected);
+                    rejected_total += rejected.size();
+                }
+                std::string variant = stream + (batch == 1 ? "/add_edge" : "/add_edges_" + std::to_string(batch));
+                report("incremental", variant, opt.nodes, updates.size(), t.ms());
+                keep_alive(rejected_total);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include "bench_suites.hpp"
+#include "bench_util.hpp"
+
+#include "layout.hpp"
+#include "output_writer.hpp"
+#include "toposort.hpp"
+
+#include <memory>
+#include <sstream>
+
+namespace {
+// The pre-writer serializers: std::to_string per element into a growing string, iostreams for layouts.
+template <class T>
+BENCH_NOINLINE std::string legacy_json_array(const std::vector<T> &a) {
+    std::string s = "[";
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (i) s += ",";
+        s += std::to_string(a[i]);
+    }
+    s += "]";
+    return s;
+}
+
+BENCH_NOINLINE std::string legacy_layout_json(const std::vector<LayoutPoint> &pts) {
+    std::ostringstream oss;
+    oss << '[';
+    for (size_t i = 0; i < pts.size(); ++i) {
+        const auto &p = pts[i];
+        if (i) oss << ',';
+        oss << "{\"id\":" << p.id << ",\"x\":" << p.x << ",\"y\":" << p.y << ",\"z\":" << p.z << ",\"layer\":" << p.layer
+            << '}';
+    }
+    oss << ']';
+    return oss.str();
+}
+
+struct FileCloser {
+    void operator()(std::FILE *f) const { std::fclose(f); }
+};
+
+// Streams one document to a fresh temp file and returns the bytes written (0 when the file cannot be created).
+template <class Fill>
+size_t stream_to_file(Fill &&fill) {
+    std::unique_ptr<std::FILE, FileCloser> f(std::tmpfile());
+    if (!f) return 0;
+    {
+        OutputWriter w(f.get());
+        fill(w);
+        if (!w.flush()) return 0;
+    }
+    return static_cast<size_t>(std::ftell(f.get()));
+}
+
+template <class Fill>
+size_t write_to_string(Fill &&fill) {
+    std::string s;
+    OutputWriter w(s);
+    fill(w);
+    w.flush();
+    keep_alive(s.empty() ? 0 : s[s.size() / 2]);
+    return s.size();
+}
+
+template <class Fn>
+void measure(const std::string &variant, Fn &&fn) {
+    BenchTimer t;
+    size_t bytes = fn();
+    report_throughput("output", variant, bytes, t.ms());
+}
+} // namespace
+
+// Serializing a topological order, the CSR arrays (h/list) and a layout: the old to_string / ostringstream path vs
+// OutputWriter into a string, streamed to a file, and the NDJSON and binary encodings of ResultWriter.
+int run_output_bench(const BenchOptions &opt) {
+    CompressedGraph g;
+    g.build_from_edges(opt.nodes, random_dag_edges(opt.nodes, opt.edges, opt.seed));
+    std::vector<bench_node_t> topo;
+    if (KahnTopoSolver(g).run(topo)) {
+        std::fprintf(stderr, "output bench: generated graph has a cycle\n");
+        return 1;
+    }
+    std::vector<LayoutPoint> pts = make_layered_layout(g, topo);
+    std::vector<uint32_t> offsets;
+    std::vector<bench_node_t> neighbors;
+    g.export_csr(offsets, neighbors);
+
+    for (int rep = 0; rep < opt.reps; ++rep) {
+        measure("topo/to_string", [&] { return legacy_json_array(topo).size(); });
+        measure("topo/writer_string", [&] { return write_to_string([&](OutputWriter &w) { write_json_array(w, topo); }); });
+        measure("topo/writer_file", [&] { return stream_to_file([&](OutputWriter &w) { write_json_array(w, topo); }); });
+        for (OutputFormat f : {OutputFormat::kNdjson, OutputFormat::kBinary}) {
+            measure(f == OutputFormat::kNdjson ? "topo/ndjson_file" : "topo/binary_file", [&] {
+                return stream_to_file([&](OutputWriter &w) {
+                    ResultWriter doc(w, f);
+                    doc.array("topo", topo);
+                    doc.finish();
+                });
+            });
+        }
+
+        measure("csr/to_string", [&] { return legacy_json_array(offsets).size() + legacy_json_array(neighbors).size(); });
+        measure("csr/writer_file", [&] {
+            return stream_to_file([&](OutputWriter &w) {
+                ResultWriter doc(w, OutputFormat::kJson);
+                doc.array("h", offsets);
+                doc.array("list", neighbors);
+                doc.finish();
+            });
+        });
+        measure("csr/binary_file", [&] {
+            return stream_to_file([&](OutputWriter &w) {
+                ResultWriter doc(w, OutputFormat::kBinary);
+                doc.array("h", offsets);
+                doc.array("list", neighbors);
+                doc.finish();
+            });
+        });
+
+        measure("layout/ostringstream", [&] { return legacy_layout_json(pts).size(); });
+        measure("layout/writer_string", [&] { return write_to_string([&](OutputWriter &w) { write_layout_json(w, pts); }); });
+        measure("layout/writer_file", [&] { return stream_to_file([&](OutputWriter &w) { write_layout_json(w, pts); }); });
+        for (OutputFormat f : {OutputFormat::kNdjson, OutputFormat::kBinary}) {
+            measure(f == OutputFormat::kNdjson ? "layout/ndjson_file" : "layout/binary_file", [&] {
+                return stream_to_file([&](OutputWriter &w) {
+                    ResultWriter doc(w, f);
+                    doc.layout("layout", pts);
+                    doc.finish();
+                });
+            });
+        }
+    }
+    return 0;
+}
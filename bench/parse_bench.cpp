@@ -0,0 +1,101 @@
+#include "bench_suites.hpp"
+#include "bench_util.hpp"
+
+#include "graph_backend.hpp"
+#include "text_parser.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+namespace {
+// The pre-streaming loader: stringstream >> int into a token vector, then adjacency lists, then CSR.
+BENCH_NOINLINE bool legacy_load(const std::string &text, std::vector<uint32_t> &offsets, std::vector<uint32_t> &neighbors) {
+    std::stringstream ss(text);
+    int n, m;
+    if (!(ss >> n >> m) || n < 0 || m < 0) return false;
+    std::vector<int> rest;
+    rest.reserve(static_cast<size_t>(n + m) * 2);
+    int x;
+    while (ss >> x) rest.push_back(x);
+    std::vector<std::vector<uint32_t>> adj(static_cast<size_t>(n));
+    if (static_cast<int>(rest.size()) >= n + 1 && rest[n] == static_cast<int>(rest.size()) - (n + 1)) {
+        for (int u = 0; u < n; ++u) {
+            for (int idx = rest[u]; idx < rest[u + 1]; ++idx) adj[u].push_back(static_cast<uint32_t>(rest[n + 1 + idx]));
+        }
+    } else if (static_cast<int>(rest.size()) == 2 * m) {
+        for (int i = 0; i < m; ++i) adj[rest[2 * i]].push_back(static_cast<uint32_t>(rest[2 * i + 1]));
+    } else {
+        return false;
+    }
+    offsets.assign(adj.size() + 1, 0);
+    neighbors.clear();
+    for (size_t u = 0; u < adj.size(); ++u) {
+        std::sort(adj[u].begin(), adj[u].end());
+        adj[u].erase(std::unique(adj[u].begin(), adj[u].end()), adj[u].end());
+        neighbors.insert(neighbors.end(), adj[u].begin(), adj[u].end());
+        offsets[u + 1] = static_cast<uint32_t>(neighbors.size());
+    }
+    return true;
+}
+
+std::string edge_list_text(size_t n, const EdgeList &edges) {
+    std::string s = std::to_string(n) + " " + std::to_string(edges.size()) + "\n";
+    for (const auto &e : edges) {
+        s += std::to_string(e.first);
+        s += ' ';
+        s += std::to_string(e.second);
+        s += '\n';
+    }
+    return s;
+}
+
+std::string csr_text(const CsrData &csr) {
+    size_t n = csr.offsets.size() - 1;
+    std::string s = std::to_string(n) + " " + std::to_string(csr.neighbors.size()) + "\n";
+    for (uint32_t o : csr.offsets) {
+        s += std::to_string(o);
+        s += ' ';
+    }
+    s += '\n';
+    for (uint32_t v : csr.neighbors) {
+        s += std::to_string(v);
+        s += ' ';
+    }
+    s += '\n';
+    return s;
+}
+}
+
+// Text loading throughput (MB/s) for edge-list and CSR input: legacy stringstream path vs the chunked parser.
+int run_parse_bench(const BenchOptions &opt) {
+    EdgeList edges = random_dag_edges(opt.nodes, opt.edges, opt.seed);
+    CsrData csr;
+    build_csr_from_edges(opt.nodes, edges, csr);
+    const std::string inputs[2] = {edge_list_text(opt.nodes, edges), csr_text(csr)};
+    const char *names[2] = {"edge_list", "csr"};
+
+    for (int rep = 0; rep < opt.reps; ++rep) {
+        for (int k = 0; k < 2; ++k) {
+            const std::string &text = inputs[k];
+            std::vector<uint32_t> offsets, neighbors;
+            {
+                BenchTimer t;
+                legacy_load(text, offsets, neighbors);
+                report_throughput("parse", std::string(names[k]) + "/stringstream", text.size(), t.ms());
+            }
+            CsrData out;
+            std::string err;
+            {
+                BenchTimer t;
+                parse_graph_text(text.data(), text.size(), out, err);
+                report_throughput("parse", std::string(names[k]) + "/chunked", text.size(), t.ms());
+            }
+            if (out.offsets != offsets || out.neighbors != neighbors) {
+                std::fprintf(stderr, "parse mismatch on %s input: %s\n", names[k], err.c_str());
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include "bench_suites.hpp"
+#include "bench_util.hpp"
+
+#include "reorder.hpp"
+#include "toposort.hpp"
+
+// For each relabeling strategy: cost of the relabel itself, then Kahn and DFS per edge on the relabeled graph and the
+// varint footprint it compresses to. The input ids are a random permutation, as for real-world labels.
+int run_reorder_bench(const BenchOptions &opt) {
+    CompressedGraph g;
+    g.build_from_edges(opt.nodes, random_dag_edges(opt.nodes, opt.edges, opt.seed));
+    size_t m = edge_count(g);
+
+    for (ReorderStrategy s : {ReorderStrategy::kNone, ReorderStrategy::kBfs, ReorderStrategy::kRcm,
+                              ReorderStrategy::kDegree, ReorderStrategy::kLevel}) {
+        std::string name = reorder_strategy_name(s);
+        for (int rep = 0; rep < opt.reps; ++rep) {
+            BenchTimer relabel_timer;
+            ReorderedGraph rg(g, s);
+            report("reorder", name + "/relabel", opt.nodes, m, relabel_timer.ms());
+
+            std::vector<bench_node_t> order;
+            {
+                BenchTimer t;
+                KahnTopoSolver(rg.graph()).run(order);
+                rg.map_back(order);
+                report("reorder", name + "/kahn", opt.nodes, m, t.ms());
+            }
+            {
+                BenchTimer t;
+                DFSTopoSolver(rg.graph()).run(order);
+                rg.map_back(order);
+                report("reorder", name + "/dfs", opt.nodes, m, t.ms());
+            }
+            keep_alive(order.size());
+            if (rep == 0) {
+                rg.graph().build_varint();
+                report_bytes("reorder", name + "/varint", opt.nodes, m, rg.graph().varint_data().size());
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include "bench_suites.hpp"
+#include "bench_util.hpp"
+
+#include "parallel.hpp"
+#include "schedule.hpp"
+
+// Critical-path analysis (single thread vs all workers) and list scheduling under each priority rule on a random task
+// DAG with durations in [1, 100]. ns_per_edge is per edge of the graph.
+int run_schedule_bench(const BenchOptions &opt) {
+    CompressedGraph g;
+    g.build_from_edges(opt.nodes, random_dag_edges(opt.nodes, opt.edges, opt.seed));
+    size_t m = edge_count(g);
+    std::mt19937_64 rng(opt.seed + 1);
+    std::vector<uint32_t> weight(opt.nodes);
+    for (auto &w : weight) w = static_cast<uint32_t>(1 + rng() % 100);
+
+    size_t workers = default_worker_count();
+    for (int rep = 0; rep < opt.reps; ++rep) {
+        for (size_t p : {size_t{1}, workers}) {
+            BenchTimer t;
+            CriticalPathResult cp = critical_path(g, weight, p);
+            report("schedule", "critical_path/workers_" + std::to_string(p), opt.nodes, m, t.ms());
+            keep_alive(cp.makespan);
+            if (p == workers) break; // one run when the machine has a single core
+        }
+        for (PriorityRule rule : {PriorityRule::kLongestPath, PriorityRule::kLongestTask, PriorityRule::kFifo}) {
+            for (size_t processors : {size_t{8}, size_t{256}}) {
+                BenchTimer t;
+                ScheduleResult s = list_schedule(g, weight, processors, rule);
+                report("schedule", std::string("list/") + priority_rule_name(rule) + "/p" + std::to_string(processors),
+                       opt.nodes, m, t.ms());
+                keep_alive(s.makespan);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "bench_suites.hpp"
+#include "bench_util.hpp"
+
+#include "instrument.hpp"
+#include "parallel.hpp"
+#include "toposort.hpp"
+
+namespace {
+struct SolverLine {
+    const char *family;
+    std::string variant;
+    size_t n;
+    size_t m;
+    double load_ms; // building the representation the solver reads
+    double ms;
+    const CompressedGraph &g;
+    bool instrumented{false};
+};
+
+// One JSON line per measurement, with the footprint of the graph as it stands and the peak RSS so far. Solver lines
+// carry the phases and counters recorded during the run when instrumentation is on.
+void report_solver(const SolverLine &l) {
+    double edges_per_s = l.ms <= 0.0 ? 0.0 : static_cast<double>(l.m) / (l.ms / 1000.0);
+    std::printf("{\"suite\":\"solvers\",\"graph\":\"%s\",\"variant\":\"%s\",\"n\":%zu,\"m\":%zu,\"load_ms\":%.3f,"
+                "\"ms\":%.3f,\"edges_per_s\":%.0f,\"dense_bytes\":%zu,\"varint_bytes\":%zu,\"peak_rss_kb\":%zu",
+                l.family, l.variant.c_str(), l.n, l.m, l.load_ms, l.ms, edges_per_s, l.g.dense_bytes(),
+                l.g.varint_bytes(), peak_rss_kb());
+    if (l.instrumented) std::printf(",\"instr\":%s", instr::to_json(instr::snapshot()).c_str());
+    std::printf("}\n");
+    std::fflush(stdout);
+}
+
+template <class Run>
+void time_solver(const char *family, const std::string &variant, size_t n, size_t m, double load_ms,
+                 const CompressedGraph &g, Run &&run) {
+    std::vector<bench_node_t> order;
+    instr::reset();
+    BenchTimer t;
+    bool cycle = run(order);
+    double ms = t.ms();
+    if (cycle || order.size() != n) std::fprintf(stderr, "%s/%s: solver reported a cycle\n", family, variant.c_str());
+    report_solver({family, variant, n, m, load_ms, ms, g, instr::enabled()});
+    keep_alive(order.size());
+}
+
+void run_family(const char *family, const BenchOptions &opt) {
+    const size_t n = opt.nodes;
+    const size_t workers = default_worker_count();
+    CompressedGraph g;
+    double csr_ms, varint_ms;
+    {
+        EdgeList edges;
+        generate_dag_edges(family, n, opt.edges, opt.seed, edges);
+        BenchTimer t;
+        g.build_from_edges(n, edges);
+        csr_ms = t.ms();
+    }
+    {
+        BenchTimer t;
+        g.build_varint();
+        varint_ms = t.ms();
+    }
+    size_t m = edge_count(g);
+    report_solver({family, "load/csr", n, m, csr_ms, csr_ms, g});
+    report_solver({family, "load/varint", n, m, varint_ms, varint_ms, g});
+
+    for (int rep = 0; rep < opt.reps; ++rep) {
+        time_solver(family, "dfs", n, m, csr_ms, g, [&](std::vector<bench_node_t> &o) {
+            return DFSTopoSolver(g).run(o);
+        });
+        time_solver(family, "kahn", n, m, csr_ms, g, [&](std::vector<bench_node_t> &o) {
+            return KahnTopoSolver(g).run(o);
+        });
+        time_solver(family, "lexi_min", n, m, csr_ms, g, [&](std::vector<bench_node_t> &o) {
+            return LexicographicKahnSolver(g, true).run(o);
+        });
+        time_solver(family, "parallel_kahn/workers_" + std::to_string(workers), n, m, csr_ms, g,
+                    [&](std::vector<bench_node_t> &o) { return ParallelKahnSolver(g, workers).run(o); });
+        // Initial order only; insertion streams are the incremental suite.
+        time_solver(family, "incremental", n, m, csr_ms, g, [&](std::vector<bench_node_t> &o) {
+            return IncrementalTopoSolver(g).run(o);
+        });
+    }
+
+    // Same solvers straight on the varint rows.
+    g.release_dense();
+    for (int rep = 0; rep < opt.reps; ++rep) {
+        time_solver(family, "dfs/varint", n, m, varint_ms, g, [&](std::vector<bench_node_t> &o) {
+            return DFSTopoSolver(g).run(o);
+        });
+        time_solver(family, "kahn/varint", n, m, varint_ms, g, [&](std::vector<bench_node_t> &o) {
+            return KahnTopoSolver(g).run(o);
+        });
+    }
+}
+}
+
+// Every solver on each synthetic DAG family (--graph all, or one of kDagFamilies): load time (edge list -> CSR,
+// CSR -> varint), sort time, edges per second, dense vs varint bytes and peak RSS, one JSON line per measurement.
+int run_solvers_bench(const BenchOptions &opt) {
+    bool known = opt.graph == "all";
+    for (const char *family : kDagFamilies) {
+        if (opt.graph != "all" && opt.graph != family) continue;
+        run_family(family, opt);
+        known = true;
+    }
+    if (!known) {
+        std::fprintf(stderr, "unknown graph family: %s\n", opt.graph.c_str());
+        return 2;
+    }
+    return 0;
+}
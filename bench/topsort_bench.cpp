@@ -0,0 +1,59 @@
+#include "bench_suites.hpp"
+#include "instrument.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+int run_suite(const BenchOptions &opt) {
+    if (opt.suite == "traversal") return run_traversal_bench(opt);
+    if (opt.suite == "parse") return run_parse_bench(opt);
+    if (opt.suite == "varint") return run_varint_bench(opt);
+    if (opt.suite == "reorder") return run_reorder_bench(opt);
+    if (opt.suite == "incremental") return run_incremental_bench(opt);
+    if (opt.suite == "schedule") return run_schedule_bench(opt);
+    if (opt.suite == "solvers") return run_solvers_bench(opt);
+    if (opt.suite == "output") return run_output_bench(opt);
+    std::fprintf(stderr, "unknown suite: %s\n", opt.suite.c_str());
+    return 2;
+}
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: topsort_bench [--suite traversal|parse|varint|reorder|incremental|schedule|solvers|output]\n"
+                 "                     [--graph all|random|layered|chain|fanout|powerlaw] [--nodes N] [--edges M]\n"
+                 "                     [--seed S] [--reps R] [--instrument 0|1] [--trace FILE]\n");
+}
+}
+
+int main(int argc, char **argv) {
+    BenchOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--help" || arg == "-h") { usage(); return 0; }
+        if (!val) { usage(); return 2; }
+        if (arg == "--suite") opt.suite = val;
+        else if (arg == "--graph") opt.graph = val;
+        else if (arg == "--nodes") opt.nodes = std::strtoull(val, nullptr, 10);
+        else if (arg == "--edges") opt.edges = std::strtoull(val, nullptr, 10);
+        else if (arg == "--seed") opt.seed = std::strtoull(val, nullptr, 10);
+        else if (arg == "--reps") opt.reps = std::atoi(val);
+        else if (arg == "--instrument") opt.instrument = std::atoi(val) != 0;
+        else if (arg == "--trace") opt.trace = val;
+        else { usage(); return 2; }
+        ++i;
+    }
+    if (!opt.trace.empty()) instr::set_tracing(true);
+    else if (opt.instrument) instr::set_enabled(true);
+
+    int rc = run_suite(opt);
+    std::string err;
+    if (!opt.trace.empty() && !instr::write_chrome_trace(opt.trace, err)) {
+        std::fprintf(stderr, "%s\n", err.c_str());
+        return 1;
+    }
+    return rc;
+}
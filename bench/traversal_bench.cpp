@@ -0,0 +1,101 @@
+#include "bench_suites.hpp"
+#include "bench_util.hpp"
+
+#include "toposort.hpp"
+
+#include <functional>
+
+namespace {
+// The pre-kernel traversal path: a virtual neighbor_span per node plus a std::function call per edge.
+BENCH_NOINLINE void legacy_for_each_neighbor(const GraphInterface &g, bench_node_t u,
+                                             const std::function<void(bench_node_t)> &fn) {
+    auto span = g.neighbor_span(u);
+    for (auto it = span.first; it != span.second; ++it) fn(*it);
+}
+
+BENCH_NOINLINE void legacy_indegrees(const GraphInterface &g, std::vector<uint32_t> &indeg) {
+    size_t n = g.node_count();
+    indeg.assign(n, 0);
+    for (bench_node_t u = 0; u < n; ++u) legacy_for_each_neighbor(g, u, [&](bench_node_t v) { indeg[v]++; });
+}
+
+BENCH_NOINLINE void virtual_indegrees(const GraphInterface &g, std::vector<uint32_t> &indeg) {
+    kernels::indegrees(g, indeg);
+}
+
+BENCH_NOINLINE bool legacy_kahn(const GraphInterface &g, std::vector<bench_node_t> &order) {
+    std::vector<uint32_t> indeg;
+    legacy_indegrees(g, indeg);
+    size_t n = g.node_count();
+    order.clear();
+    for (bench_node_t u = 0; u < n; ++u) if (indeg[u] == 0) order.push_back(u);
+    for (size_t head = 0; head < order.size(); ++head) {
+        legacy_for_each_neighbor(g, order[head], [&](bench_node_t v) {
+            if (--indeg[v] == 0) order.push_back(v);
+        });
+    }
+    return order.size() != n;
+}
+}
+
+// Per-edge cost of neighbor traversal: std::function visitor vs virtual span vs kernels on CompressedGraph, and heap vs
+// bitset frontier for the lexicographic orders.
+int run_traversal_bench(const BenchOptions &opt) {
+    CompressedGraph g;
+    g.build_from_edges(opt.nodes, random_dag_edges(opt.nodes, opt.edges, opt.seed));
+    size_t m = edge_count(g);
+
+    for (int rep = 0; rep < opt.reps; ++rep) {
+        std::vector<uint32_t> indeg;
+        {
+            BenchTimer t;
+            legacy_indegrees(g, indeg);
+            report("traversal", "indegrees/std_function", opt.nodes, m, t.ms());
+        }
+        keep_alive(indeg.empty() ? 0u : indeg[0]);
+        {
+            BenchTimer t;
+            virtual_indegrees(g, indeg);
+            report("traversal", "indegrees/virtual_span", opt.nodes, m, t.ms());
+        }
+        keep_alive(indeg.empty() ? 0u : indeg[0]);
+        {
+            BenchTimer t;
+            kernels::indegrees(g, indeg);
+            report("traversal", "indegrees/kernel", opt.nodes, m, t.ms());
+        }
+        keep_alive(indeg.empty() ? 0u : indeg[0]);
+
+        std::vector<bench_node_t> order;
+        {
+            BenchTimer t;
+            legacy_kahn(g, order);
+            report("traversal", "kahn/std_function", opt.nodes, m, t.ms());
+        }
+        {
+            BenchTimer t;
+            KahnTopoSolver(g).run(order);
+            report("traversal", "kahn/kernel", opt.nodes, m, t.ms());
+        }
+        keep_alive(order.size());
+
+        CsrView view = g.snapshot();
+        for (bool min_first : {true, false}) {
+            std::string algo = min_first ? "lexi_min" : "lexi_max";
+            {
+                BenchTimer t;
+                kernels::indegrees(view, indeg);
+                if (min_first) kernels::lexicographic_kahn<std::greater<bench_node_t>>(view, indeg, order);
+                else kernels::lexicographic_kahn<std::less<bench_node_t>>(view, indeg, order);
+                report("traversal", algo + "/heap", opt.nodes, m, t.ms());
+            }
+            {
+                BenchTimer t;
+                LexicographicKahnSolver(g, min_first).run(order);
+                report("traversal", algo + "/bitset", opt.nodes, m, t.ms());
+            }
+            keep_alive(order.size());
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "bench_suites.hpp"
+#include "bench_util.hpp"
+
+#include "toposort.hpp"
+
+#include <random>
+
+namespace {
+// Banded DAG: every edge u -> v has v - u < 64, so almost all deltas fit in one varint byte.
+EdgeList banded_dag_edges(size_t n, size_t m, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    EdgeList edges;
+    if (n < 2) return edges;
+    edges.reserve(m);
+    for (size_t i = 0; i < m; ++i) {
+        bench_node_t u = static_cast<bench_node_t>(rng() % (n - 1));
+        bench_node_t v = static_cast<bench_node_t>(u + 1 + rng() % 63);
+        if (v >= n) v = static_cast<bench_node_t>(n - 1);
+        edges.emplace_back(u, v);
+    }
+    return edges;
+}
+
+// The pre-bulk decoder: one decode_varint32 call per neighbor.
+BENCH_NOINLINE uint64_t scalar_sum(const CompressedGraph &g) {
+    const auto &data = g.varint_data();
+    const auto &offs = g.varint_offsets();
+    uint64_t sum = 0;
+    for (size_t u = 0; u < g.node_count(); ++u) {
+        const uint8_t *ptr = data.data() + offs[u];
+        const uint8_t *end = data.data() + offs[u + 1];
+        uint32_t prev = 0;
+        while (ptr < end) {
+            prev += decode_varint32(ptr, end);
+            sum += prev;
+        }
+    }
+    return sum;
+}
+
+BENCH_NOINLINE uint64_t bulk_sum(const CompressedGraph &g) {
+    uint64_t sum = 0;
+    for (bench_node_t u = 0; u < g.node_count(); ++u) g.for_each_neighbor_varint(u, [&](bench_node_t v) { sum += v; });
+    return sum;
+}
+
+BENCH_NOINLINE uint64_t dense_sum(const CompressedGraph &g) {
+    uint64_t sum = 0;
+    for (bench_node_t u = 0; u < g.node_count(); ++u) g.for_each_neighbor(u, [&](bench_node_t v) { sum += v; });
+    return sum;
+}
+
+void run_one(const char *shape, const EdgeList &edges, const BenchOptions &opt) {
+    CompressedGraph g;
+    g.build_from_edges(opt.nodes, edges);
+    g.build_varint();
+    size_t m = edge_count(g);
+    std::string prefix = std::string(shape) + "/";
+    for (int rep = 0; rep < opt.reps; ++rep) {
+        {
+            BenchTimer t;
+            keep_alive(scalar_sum(g));
+            report("varint", prefix + "scalar", opt.nodes, m, t.ms());
+        }
+        {
+            BenchTimer t;
+            keep_alive(bulk_sum(g));
+            report("varint", prefix + "bulk", opt.nodes, m, t.ms());
+        }
+        {
+            BenchTimer t;
+            keep_alive(dense_sum(g));
+            report("varint", prefix + "dense", opt.nodes, m, t.ms());
+        }
+    }
+
+    // Whole solver on the dense CSR vs the same graph in compressed-only mode.
+    CompressedGraph compressed;
+    compressed.build_from_edges(opt.nodes, edges);
+    compressed.release_dense();
+    std::vector<bench_node_t> order;
+    for (int rep = 0; rep < opt.reps; ++rep) {
+        {
+            BenchTimer t;
+            KahnTopoSolver(g).run(order);
+            report("varint", prefix + "kahn/dense", opt.nodes, m, t.ms());
+        }
+        {
+            BenchTimer t;
+            KahnTopoSolver(compressed).run(order);
+            report("varint", prefix + "kahn/compressed_only", opt.nodes, m, t.ms());
+        }
+        keep_alive(order.size());
+    }
+}
+}
+
+// Per-edge cost of varint neighbor decoding: scalar byte loop vs bulk (SIMD) decoder, with dense CSR as the floor;
+// then Kahn on the dense CSR vs compressed-only mode.
+int run_varint_bench(const BenchOptions &opt) {
+    run_one("random", random_dag_edges(opt.nodes, opt.edges, opt.seed), opt);
+    run_one("banded", banded_dag_edges(opt.nodes, opt.edges, opt.seed), opt);
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include "binary_format.hpp"
+#include "hash.hpp"
+#include "parallel.hpp"
+#include "text_parser.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+// Appends sections to the file, zero-padding each to 8 bytes and hashing everything it writes.
+class SectionWriter {
+public:
+    explicit SectionWriter(std::FILE *f) : f_(f) {}
+
+    bool write(const void *data, size_t len) {
+        if (len != 0 && std::fwrite(data, 1, len, f_) != len) return false;
+        hash_.update(data, len);
+        pos_ += len;
+        static const char zeros[8] = {};
+        size_t pad = static_cast<size_t>((8 - pos_ % 8) % 8);
+        if (pad != 0 && std::fwrite(zeros, 1, pad, f_) != pad) return false;
+        hash_.update(zeros, pad);
+        pos_ += pad;
+        return true;
+    }
+
+    uint64_t pos() const { return pos_; }
+    uint64_t checksum() const { return hash_.finish(); }
+
+private:
+    std::FILE *f_;
+    uint64_t pos_{sizeof(binfmt::Header)};
+    Hash64 hash_{};
+};
+
+bool section_in_file(uint64_t at, uint64_t bytes, uint64_t file_size) {
+    return at % 8 == 0 && at >= sizeof(binfmt::Header) && at <= file_size && bytes <= file_size - at;
+}
+
+// Rows and ids below this are validated on the calling thread.
+constexpr size_t kParallelValidate = 1u << 16;
+
+// What the kernels index by without further checks: offsets[0..n] non-decreasing up to `limit`, and every id a row
+// yields below n. decode(b, e) checks the ids of rows [b, e) once their offsets are known to be in range.
+template <class Decode>
+bool rows_valid(const uint32_t *offsets, size_t n, uint64_t limit, uint64_t work, Decode &&decode) {
+    if (offsets[0] != 0 || offsets[n] > limit) return false;
+    size_t workers = work < kParallelValidate ? 1 : default_worker_count();
+    std::vector<char> bad(std::max<size_t>(1, std::min(workers, n)), 0);
+    parallel_for(n, workers, [&](size_t w, size_t b, size_t e) {
+        for (size_t u = b; u < e; ++u) {
+            if (offsets[u] > offsets[u + 1]) {
+                bad[w] = 1;
+                return;
+            }
+        }
+        if (offsets[e] > limit || !decode(b, e)) bad[w] = 1;
+    });
+    return std::find(bad.begin(), bad.end(), 1) == bad.end();
+}
+}
+
+bool write_binary_graph(const std::string &path, const CompressedGraph &g, uint32_t sections, std::string &err) {
+    sections |= binfmt::kDense;
+    // varint_view() re-encodes only when the current rows are missing or behind pending edits.
+    VarintView varint = (sections & binfmt::kVarint) ? g.varint_view() : VarintView();
+    CsrView view = g.snapshot();
+    const size_t n = view.node_count();
+
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        err = "cannot open " + path + " for writing";
+        return false;
+    }
+    binfmt::Header h{};
+    std::memcpy(h.magic, binfmt::kMagic, sizeof(h.magic));
+    h.version = binfmt::kVersion;
+    h.endian_tag = binfmt::kEndianTag;
+    h.sections = sections;
+    h.node_count = n;
+    h.edge_count = view.edge_count();
+
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1;
+    SectionWriter out(f);
+    if (ok) {
+        h.offsets_at = out.pos();
+        ok = out.write(view.offsets(), (n + 1) * sizeof(uint32_t));
+    }
+    if (ok) {
+        h.neighbors_at = out.pos();
+        ok = out.write(view.neighbors(), view.edge_count() * sizeof(GraphInterface::node_t));
+    }
+    if (ok && (sections & binfmt::kVarint)) {
+        h.varint_offsets_at = out.pos();
+        ok = out.write(varint.offsets(), (n + 1) * sizeof(uint32_t));
+        h.varint_at = out.pos();
+        h.varint_bytes = varint.byte_count();
+        ok = ok && out.write(varint.bytes(), varint.byte_count());
+    }
+    if (ok && (sections & binfmt::kIndegree)) {
+        h.indeg_at = out.pos();
+        ok = out.write(g.indegrees().data(), g.indegrees().size() * sizeof(uint32_t));
+    }
+    if (ok) {
+        h.file_size = out.pos();
+        h.payload_checksum = out.checksum();
+        ok = std::fseek(f, 0, SEEK_SET) == 0 && std::fwrite(&h, sizeof(h), 1, f) == 1;
+    }
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) err = "write failed for " + path;
+    return ok;
+}
+
+bool MappedGraph::open(const std::string &path, std::string &err, bool verify_checksum) {
+    auto file = std::make_shared<InputBuffer>();
+    if (!file->open_file(path, err)) return false;
+    const char *base = file->data();
+    const uint64_t size = file->size();
+
+    binfmt::Header h;
+    if (size < sizeof(h)) {
+        err = "not a binary graph (file too small)";
+        return false;
+    }
+    std::memcpy(&h, base, sizeof(h));
+    if (std::memcmp(h.magic, binfmt::kMagic, sizeof(h.magic)) != 0) {
+        err = "not a binary graph (bad magic)";
+        return false;
+    }
+    if (h.version != binfmt::kVersion) {
+        err = "unsupported binary graph version " + std::to_string(h.version);
+        return false;
+    }
+    if (h.endian_tag != binfmt::kEndianTag) {
+        err = "binary graph was written with a different byte order";
+        return false;
+    }
+    if (h.file_size != size) {
+        err = "binary graph is truncated";
+        return false;
+    }
+    if (!(h.sections & binfmt::kDense)) {
+        err = "binary graph has no dense section";
+        return false;
+    }
+    const uint64_t n = h.node_count;
+    const uint64_t m = h.edge_count;
+    bool layout_ok = n < UINT32_MAX && m <= UINT32_MAX &&
+                     section_in_file(h.offsets_at, (n + 1) * sizeof(uint32_t), size) &&
+                     section_in_file(h.neighbors_at, m * sizeof(node_t), size);
+    if (layout_ok && (h.sections & binfmt::kVarint)) {
+        layout_ok = section_in_file(h.varint_offsets_at, (n + 1) * sizeof(uint32_t), size) &&
+                    section_in_file(h.varint_at, h.varint_bytes, size);
+    }
+    if (layout_ok && (h.sections & binfmt::kIndegree)) {
+        layout_ok = section_in_file(h.indeg_at, n * sizeof(uint32_t), size);
+    }
+    const uint32_t *offsets = reinterpret_cast<const uint32_t *>(base + h.offsets_at);
+    if (!layout_ok || offsets[0] != 0 || offsets[n] != m) {
+        err = "binary graph has an inconsistent layout";
+        return false;
+    }
+    if (verify_checksum) {
+        if (hash_bytes64(base + sizeof(h), size - sizeof(h)) != h.payload_checksum) {
+            err = "binary graph checksum mismatch";
+            return false;
+        }
+    }
+    // A matching checksum does not rule out a file written by something else, so the structure is always checked.
+    const node_t *neighbors = reinterpret_cast<const node_t *>(base + h.neighbors_at);
+    bool rows_ok = rows_valid(offsets, static_cast<size_t>(n), m, n + m, [&](size_t b, size_t e) {
+        for (uint64_t i = offsets[b]; i < offsets[e]; ++i) {
+            if (neighbors[i] >= n) return false;
+        }
+        return true;
+    });
+    if (rows_ok && (h.sections & binfmt::kVarint)) {
+        const uint32_t *voffsets = reinterpret_cast<const uint32_t *>(base + h.varint_offsets_at);
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(base + h.varint_at);
+        const uint8_t *limit = bytes + h.varint_bytes;
+        rows_ok = rows_valid(voffsets, static_cast<size_t>(n), h.varint_bytes, n + h.varint_bytes,
+                             [&](size_t b, size_t e) {
+            bool ids_ok = true;
+            for (size_t u = b; u < e && ids_ok; ++u) {
+                for_each_varint_row(bytes + voffsets[u], bytes + voffsets[u + 1], limit,
+                                    [&](node_t v) { ids_ok &= v < n; });
+            }
+            return ids_ok;
+        });
+    }
+    if (!rows_ok) {
+        err = "binary graph has corrupt rows (offsets out of order or neighbor ids out of range)";
+        return false;
+    }
+
+    file_ = std::move(file);
+    n_ = static_cast<size_t>(n);
+    m_ = static_cast<size_t>(m);
+    sections_ = h.sections;
+    offsets_ = offsets;
+    neighbors_ = neighbors;
+    varint_offsets_ = (h.sections & binfmt::kVarint) ? reinterpret_cast<const uint32_t *>(base + h.varint_offsets_at) : nullptr;
+    varint_ = (h.sections & binfmt::kVarint) ? reinterpret_cast<const uint8_t *>(base + h.varint_at) : nullptr;
+    varint_bytes_ = (h.sections & binfmt::kVarint) ? static_cast<size_t>(h.varint_bytes) : 0;
+    indeg_ = (h.sections & binfmt::kIndegree) ? reinterpret_cast<const uint32_t *>(base + h.indeg_at) : nullptr;
+    return true;
+}
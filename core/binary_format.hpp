@@ -0,0 +1,97 @@
+#pragma once
+
+#include "compressed_graph.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+class InputBuffer;
+
+// Versioned binary container for a built graph, designed to be used straight from an mmap with no parsing and no
+// copies. Layout (little-endian, every section 8-byte aligned, offsets relative to file start):
+//   BinaryGraphHeader
+//   [dense]  offsets  uint32[n+1], neighbors uint32[m]
+//   [varint] varint_offsets uint32[n+1], varint bytes (delta-coded rows + kVarintPadding zero bytes, see
+//            CompressedGraph::build_varint)
+//   [indeg]  uint32[n]
+// payload_checksum is hash_bytes64 over everything after the header.
+namespace binfmt {
+constexpr char kMagic[8] = {'T', 'S', 'C', 'S', 'R', 'B', 'I', 'N'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kEndianTag = 0x01020304u;
+
+enum Section : uint32_t {
+    kDense = 1u << 0,
+    kVarint = 1u << 1,
+    kIndegree = 1u << 2,
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_tag;
+    uint32_t sections;   // Section bits present in the file
+    uint32_t reserved;
+    uint64_t node_count;
+    uint64_t edge_count;
+    uint64_t offsets_at;
+    uint64_t neighbors_at;
+    uint64_t varint_offsets_at;
+    uint64_t varint_at;
+    uint64_t varint_bytes;
+    uint64_t indeg_at;
+    uint64_t file_size;
+    uint64_t payload_checksum;
+};
+static_assert(sizeof(Header) % 8 == 0, "header must keep sections 8-byte aligned");
+}
+
+// Serialize g with the requested sections (binfmt::Section bits; kDense is always written so readers can serve
+// neighbor_span without decoding). The varint rows are encoded only when g has no current ones. Returns false with err
+// on I/O failure.
+bool write_binary_graph(const std::string &path, const CompressedGraph &g, uint32_t sections, std::string &err);
+
+// Read-only graph over a binary file. The file is memory-mapped (a plain read on platforms without mmap) and every
+// accessor points into the mapping, so nothing is copied. Opening validates what the kernels index by without checks
+// (non-decreasing offsets inside their sections, every dense and varint neighbor id below n): one pass over the rows,
+// parallel for large graphs, about as costly as reading the file once. verify_checksum additionally hashes the whole
+// payload. Reads are thread-safe.
+class MappedGraph final : public GraphInterface {
+public:
+    using node_t = GraphInterface::node_t;
+
+    bool open(const std::string &path, std::string &err, bool verify_checksum = false);
+
+    size_t node_count() const override { return n_; }
+    std::pair<const node_t *, const node_t *> neighbor_span(node_t u) const override {
+        return {neighbors_ + offsets_[u], neighbors_ + offsets_[u + 1]};
+    }
+    // Zero-copy CsrView over the mapping; keeps the mapping alive on its own.
+    CsrView view() const { return CsrView(file_, offsets_, neighbors_, n_); }
+    // Zero-copy VarintView over the varint section; empty when the file has none.
+    VarintView varint_view() const {
+        return varint_ ? VarintView(file_, varint_offsets_, varint_, varint_bytes_, n_) : VarintView();
+    }
+
+    size_t edge_count() const { return m_; }
+    uint32_t sections() const { return sections_; }
+    // Optional sections; nullptr when absent from the file.
+    const uint32_t *indegrees() const { return indeg_; }
+    const uint32_t *varint_offsets() const { return varint_offsets_; }
+    const uint8_t *varint_data() const { return varint_; }
+    size_t varint_bytes() const { return varint_bytes_; }
+
+private:
+    std::shared_ptr<const InputBuffer> file_{};
+    size_t n_{0};
+    size_t m_{0};
+    uint32_t sections_{0};
+    const uint32_t *offsets_{nullptr};
+    const node_t *neighbors_{nullptr};
+    const uint32_t *varint_offsets_{nullptr};
+    const uint8_t *varint_{nullptr};
+    size_t varint_bytes_{0};
+    const uint32_t *indeg_{nullptr};
+};
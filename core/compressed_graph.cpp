@@ -1,15 +1,11 @@
 #include "compressed_graph.hpp"
+#include "csr_builder.hpp"
+#include "hash.hpp"
 
 #include <algorithm>
+#include <numeric>
 #include <stdexcept>
 
-namespace {
-void sort_and_dedup(std::vector<uint32_t> &v) {
-    std::sort(v.begin(), v.end());
-    v.erase(std::unique(v.begin(), v.end()), v.end());
-}
-}
-
 uint32_t decode_varint32(const uint8_t *&ptr, const uint8_t *end) {
     uint32_t value = 0;
     uint32_t shift = 0;
@@ -48,123 +44,380 @@ bool NodeIndex::find(const std::string &label, uint32_t &id) const {
     return true;
 }
 
+std::pair<const GraphInterface::node_t *, const GraphInterface::node_t *> VarintView::neighbor_span(node_t u) const {
+    scratch_.clear();
+    for_each_neighbor(u, [&](node_t v) { scratch_.push_back(v); });
+    return {scratch_.data(), scratch_.data() + scratch_.size()};
+}
+
+namespace {
+const VarintData &empty_varint() {
+    static const VarintData empty;
+    return empty;
+}
+
+template <class T>
+size_t capacity_bytes(const std::vector<T> &v) {
+    return v.capacity() * sizeof(T);
+}
+}
+
 void CompressedGraph::reset(size_t n) {
-    adj_lists_.assign(n, {});
+    auto data = std::make_shared<CsrData>();
+    data->offsets.assign(n + 1, 0);
+    n_ = n;
     indeg_.assign(n, 0);
-    offsets_.assign(n + 1, 0);
-    neighbors_.clear();
-    neighbors_varint_.clear();
-    varint_offsets_.clear();
-    dirty_ = true;
+    edge_hash_sum_ = 0;
+    edge_hash_stale_ = false;
+    compressed_only_ = false;
+    clear_overlay();
+    base_edges_ = 0;
+    install_csr(std::move(data));
+}
+
+void CompressedGraph::install_csr(std::shared_ptr<CsrData> data) const {
+    offsets_ = data->offsets.data();
+    neighbors_ = data->neighbors.data();
+    std::atomic_store(&csr_, std::shared_ptr<const CsrData>(std::move(data)));
+    varint_.reset();
+    dirty_.store(false, std::memory_order_release);
+}
+
+void CompressedGraph::adopt_csr(std::shared_ptr<CsrData> data) {
+    n_ = data->offsets.size() - 1;
+    compressed_only_ = false;
+    clear_overlay();
+    base_edges_ = data->neighbors.size();
+    csr_indegrees(*data, indeg_);
+    edge_hash_sum_ = csr_edge_hash_sum(data->offsets.data(), data->neighbors.data(), n_);
+    edge_hash_stale_ = false;
+    install_csr(std::move(data));
 }
 
 void CompressedGraph::build_from_adj(const std::vector<std::vector<node_t>> &adj) {
-    reset(adj.size());
+    auto data = std::make_shared<CsrData>();
+    data->offsets.assign(adj.size() + 1, 0);
     for (size_t u = 0; u < adj.size(); ++u) {
-        adj_lists_[u] = adj[u];
-        for (node_t v : adj[u]) {
+        data->offsets[u + 1] = data->offsets[u] + static_cast<uint32_t>(adj[u].size());
+    }
+    data->neighbors.reserve(data->offsets[adj.size()]);
+    for (const auto &lst : adj) {
+        for (node_t v : lst) {
             if (v >= adj.size()) throw std::out_of_range("neighbor id exceeds node_count");
-            indeg_[v]++;
+            data->neighbors.push_back(v);
         }
-        sort_and_dedup(adj_lists_[u]);
     }
-    dirty_ = true;
+    sort_dedup_rows(*data);
+    adopt_csr(std::move(data));
 }
 
 void CompressedGraph::build_from_edges(size_t n, const std::vector<std::pair<node_t, node_t>> &edges) {
-    reset(n);
-    for (const auto &e : edges) {
-        node_t u = e.first;
-        node_t v = e.second;
-        if (u >= n || v >= n) throw std::out_of_range("edge endpoint out of bounds");
-        adj_lists_[u].push_back(v);
-        indeg_[v]++;
+    auto data = std::make_shared<CsrData>();
+    build_csr_from_edges(n, edges, *data);
+    adopt_csr(std::move(data));
+}
+
+void CompressedGraph::build_from_csr(CsrData csr) {
+    if (csr.offsets.empty()) csr.offsets.assign(1, 0);
+    adopt_csr(std::make_shared<CsrData>(std::move(csr)));
+}
+
+bool CompressedGraph::row_contains(node_t u, node_t v) const {
+    if (const RowDelta *d = delta_of(u)) {
+        if (std::binary_search(d->added.begin(), d->added.end(), v)) return true;
+        if (d->replaced || std::binary_search(d->removed.begin(), d->removed.end(), v)) return false;
+    }
+    if (compressed_only_) {
+        bool found = false;
+        for_each_base_neighbor(u, [&](node_t x) { found |= x == v; });
+        return found;
     }
-    for (auto &lst : adj_lists_) sort_and_dedup(lst);
-    dirty_ = true;
+    return std::binary_search(neighbors_ + offsets_[u], neighbors_ + offsets_[u + 1], v);
+}
+
+CompressedGraph::RowDelta &CompressedGraph::touch_row(node_t u) {
+    if (delta_index_.empty()) delta_index_.assign(n_, 0);
+    if (delta_index_[u] == 0) {
+        deltas_.push_back(RowDelta{u, false, {}, {}});
+        delta_index_[u] = static_cast<uint32_t>(deltas_.size());
+        dirty_.store(true, std::memory_order_release);
+    }
+    return deltas_[delta_index_[u] - 1];
+}
+
+// Both assume the caller checked row_contains: the edge is absent for row_insert and present for row_erase.
+void CompressedGraph::row_insert(node_t u, node_t v) {
+    RowDelta &d = touch_row(u);
+    auto del = std::lower_bound(d.removed.begin(), d.removed.end(), v);
+    if (del != d.removed.end() && *del == v) {
+        d.removed.erase(del); // back in the base row
+        return;
+    }
+    d.added.insert(std::lower_bound(d.added.begin(), d.added.end(), v), v);
+}
+
+void CompressedGraph::row_erase(node_t u, node_t v) {
+    RowDelta &d = touch_row(u);
+    auto add = std::lower_bound(d.added.begin(), d.added.end(), v);
+    if (add != d.added.end() && *add == v) {
+        d.added.erase(add);
+        return;
+    }
+    d.removed.insert(std::lower_bound(d.removed.begin(), d.removed.end(), v), v);
+}
+
+void CompressedGraph::drop_delta(node_t u) {
+    if (delta_index_.empty() || delta_index_[u] == 0) return;
+    uint32_t slot = delta_index_[u] - 1;
+    if (slot + 1 != deltas_.size()) {
+        deltas_[slot] = std::move(deltas_.back());
+        delta_index_[deltas_[slot].node] = slot + 1;
+    }
+    deltas_.pop_back();
+    delta_index_[u] = 0;
+}
+
+void CompressedGraph::note_edit() {
+    ++overlay_entries_;
+    size_t base_rows = compressed_only_ ? varint_->offsets.size() - 1 : csr_ ? csr_->offsets.size() - 1 : 0;
+    if (overlay_entries_ > std::max(kMinCompactEntries, (base_edges_ + base_rows) / kCompactDivisor)) compact();
+}
+
+void CompressedGraph::clear_overlay() const {
+    deltas_.clear();
+    deltas_.shrink_to_fit();
+    delta_index_.clear();
+    delta_index_.shrink_to_fit();
+    overlay_entries_ = 0;
 }
 
 void CompressedGraph::add_edge(node_t u, node_t v) {
-    if (u >= adj_lists_.size() || v >= adj_lists_.size()) throw std::out_of_range("edge endpoint out of bounds");
-    auto &lst = adj_lists_[u];
-    lst.push_back(v);
-    std::sort(lst.begin(), lst.end());
-    lst.erase(std::unique(lst.begin(), lst.end()), lst.end());
+    if (u >= n_ || v >= n_) throw std::out_of_range("edge endpoint out of bounds");
+    if (row_contains(u, v)) return; // adjacency is a set
+    row_insert(u, v);
     indeg_[v]++;
-    dirty_ = true;
+    edge_hash_sum_ += edge_hash(u, v);
+    note_edit();
+}
+
+bool CompressedGraph::remove_edge(node_t u, node_t v) {
+    if (u >= n_ || v >= n_) throw std::out_of_range("edge endpoint out of bounds");
+    if (!row_contains(u, v)) return false;
+    row_erase(u, v);
+    indeg_[v]--;
+    edge_hash_sum_ -= edge_hash(u, v);
+    note_edit();
+    return true;
+}
+
+uint64_t CompressedGraph::fingerprint() const {
+    if (edge_hash_stale_) {
+        CsrView view = snapshot();
+        edge_hash_sum_ = csr_edge_hash_sum(view.offsets(), view.neighbors(), n_);
+        edge_hash_stale_ = false;
+    }
+    return graph_fingerprint(n_, edge_hash_sum_);
+}
+
+bool CompressedGraph::has_edge(node_t u, node_t v) const {
+    return u < n_ && v < n_ && row_contains(u, v);
+}
+
+GraphInterface::node_t CompressedGraph::add_node() {
+    node_t x = static_cast<node_t>(n_++);
+    indeg_.push_back(0);
+    if (!delta_index_.empty()) delta_index_.push_back(0);
+    touch_row(x).replaced = true; // ids past the base (or freed by remove_node) have no usable base row
+    note_edit();
+    return x;
+}
+
+GraphInterface::node_t CompressedGraph::remove_node(node_t u) {
+    if (u >= n_) throw std::out_of_range("node id out of bounds");
+    const node_t last = static_cast<node_t>(n_ - 1);
+    edge_hash_stale_ = true;
+
+    for_each_neighbor(u, [&](node_t v) { indeg_[v]--; });
+    if (indeg_[u] != 0) {
+        for (node_t x = 0; x < n_; ++x) {
+            if (x != u && row_contains(x, u)) row_erase(x, u);
+        }
+        indeg_[u] = 0;
+    }
+
+    std::vector<node_t> moved;
+    if (last != u) {
+        // Rename last -> u: its row becomes u's, and every row that points at last now points at u.
+        for_each_neighbor(last, [&](node_t v) { moved.push_back(v == last ? u : v); });
+        std::sort(moved.begin(), moved.end());
+        if (indeg_[last] != 0) {
+            for (node_t x = 0; x < last; ++x) {
+                if (x == u || !row_contains(x, last)) continue;
+                row_erase(x, last);
+                row_insert(x, u);
+            }
+        }
+        indeg_[u] = indeg_[last];
+    }
+    RowDelta &d = touch_row(u);
+    d.replaced = true;
+    d.removed.clear();
+    d.added = std::move(moved);
+    drop_delta(last);
+    delta_index_.pop_back();
+    indeg_.pop_back();
+    --n_;
+    note_edit();
+    return last;
 }
 
-void CompressedGraph::rebuild_csr_unlocked() const {
-    size_t n = adj_lists_.size();
-    offsets_.assign(n + 1, 0);
-    for (size_t i = 0; i < n; ++i) offsets_[i + 1] = offsets_[i] + adj_lists_[i].size();
-    neighbors_.resize(offsets_[n]);
-    for (size_t u = 0; u < n; ++u) {
-        auto base = offsets_[u];
-        std::copy(adj_lists_[u].begin(), adj_lists_[u].end(), neighbors_.begin() + static_cast<ptrdiff_t>(base));
+// Merge base and overlay into a fresh base of the current kind and drop the overlay. Caller holds csr_lock_.
+void CompressedGraph::compact_unlocked() const {
+    TOPSORT_PHASE("csr_rebuild");
+    TOPSORT_COUNT(kCsrRebuilds, 1);
+    size_t edges = 0;
+    if (compressed_only_) {
+        auto data = std::make_shared<VarintData>();
+        data->offsets.assign(n_ + 1, 0);
+        data->bytes.reserve(varint_->bytes.size());
+        for (node_t u = 0; u < n_; ++u) {
+            uint32_t prev = 0;
+            for_each_neighbor(u, [&](node_t v) {
+                encode_varint32(v - prev, data->bytes);
+                prev = v;
+                ++edges;
+            });
+            data->offsets[u + 1] = static_cast<uint32_t>(data->bytes.size());
+        }
+        data->bytes.resize(data->bytes.size() + kVarintPadding, 0);
+        data->bytes.shrink_to_fit();
+        varint_ = std::move(data);
+        clear_overlay();
+        base_edges_ = edges;
+        return; // dirty_ stays set in compressed-only mode
     }
-    neighbors_varint_.clear();
-    varint_offsets_.clear();
-    dirty_ = false;
+    auto data = std::make_shared<CsrData>();
+    data->offsets.assign(n_ + 1, 0);
+    data->neighbors.reserve(base_edges_ + overlay_entries_);
+    for (node_t u = 0; u < n_; ++u) {
+        for_each_neighbor(u, [&](node_t v) { data->neighbors.push_back(v); });
+        data->offsets[u + 1] = static_cast<uint32_t>(data->neighbors.size());
+    }
+    base_edges_ = data->neighbors.size();
+    clear_overlay();
+    install_csr(std::move(data));
 }
 
-void CompressedGraph::ensure_csr() const {
-    if (!dirty_) return;
+void CompressedGraph::compact() const {
     SpinGuard guard(csr_lock_);
-    if (dirty_) rebuild_csr_unlocked();
+    if (overlay_entries_ != 0 || (!compressed_only_ && !csr_)) compact_unlocked();
+}
+
+void CompressedGraph::publish() const {
+    if (compressed_only_) return; // nothing dense to publish
+    compact();
 }
 
-std::pair<const CompressedGraph::node_t *, const CompressedGraph::node_t *> CompressedGraph::neighbor_span(node_t u) const {
+std::pair<const GraphInterface::node_t *, const GraphInterface::node_t *>
+CompressedGraph::neighbor_span_slow(node_t u) const {
+    if (compressed_only_ || delta_of(u) != nullptr) {
+        scratch_.clear();
+        for_each_neighbor(u, [&](node_t v) { scratch_.push_back(v); });
+        return {scratch_.data(), scratch_.data() + scratch_.size()};
+    }
+    return {neighbors_ + offsets_[u], neighbors_ + offsets_[u + 1]};
+}
+
+CsrView CompressedGraph::snapshot() const {
+    if (compressed_only_) {
+        auto data = std::make_shared<CsrData>();
+        data->offsets.assign(n_ + 1, 0);
+        data->neighbors.reserve(static_cast<size_t>(std::accumulate(indeg_.begin(), indeg_.end(), uint64_t{0})));
+        for (node_t u = 0; u < n_; ++u) {
+            for_each_neighbor(u, [&](node_t v) { data->neighbors.push_back(v); });
+            data->offsets[u + 1] = static_cast<uint32_t>(data->neighbors.size());
+        }
+        return CsrView(std::move(data));
+    }
     ensure_csr();
-    auto base = offsets_[u];
-    auto next = offsets_[u + 1];
-    const node_t *beg = neighbors_.data() + static_cast<std::ptrdiff_t>(base);
-    return {beg, beg + static_cast<std::ptrdiff_t>(next - base)};
+    return CsrView(std::atomic_load(&csr_));
 }
 
-void CompressedGraph::for_each_neighbor(node_t u, const std::function<void(node_t)> &fn) const {
-    auto span = neighbor_span(u);
-    for (auto it = span.first; it != span.second; ++it) fn(*it);
+VarintView CompressedGraph::varint_view() const {
+    if (!varint_ || overlay_entries_ != 0) build_varint();
+    return VarintView(varint_);
+}
+
+void CompressedGraph::release_dense() {
+    if (compressed_only_) return;
+    if (!varint_ || overlay_entries_ != 0) build_varint();
+    {
+        SpinGuard guard(csr_lock_);
+        std::atomic_store(&csr_, std::shared_ptr<const CsrData>());
+        offsets_ = nullptr;
+        neighbors_ = nullptr;
+    }
+    compressed_only_ = true;
+    dirty_.store(true, std::memory_order_release);
+}
+
+CsrView CompressedGraph::published() const {
+    auto data = std::atomic_load(&csr_);
+    return data ? CsrView(std::move(data)) : CsrView();
+}
+
+size_t CompressedGraph::dense_bytes() const {
+    auto data = std::atomic_load(&csr_);
+    return data ? capacity_bytes(data->offsets) + capacity_bytes(data->neighbors) : 0;
+}
+
+size_t CompressedGraph::varint_bytes() const {
+    return varint_ ? capacity_bytes(varint_->bytes) + capacity_bytes(varint_->offsets) : 0;
+}
+
+size_t CompressedGraph::overlay_bytes() const {
+    size_t bytes = capacity_bytes(deltas_) + capacity_bytes(delta_index_);
+    for (const RowDelta &d : deltas_) bytes += capacity_bytes(d.added) + capacity_bytes(d.removed);
+    return bytes;
+}
+
+const std::vector<uint8_t> &CompressedGraph::varint_data() const {
+    return (varint_ ? *varint_ : empty_varint()).bytes;
+}
+
+const std::vector<uint32_t> &CompressedGraph::varint_offsets() const {
+    return (varint_ ? *varint_ : empty_varint()).offsets;
 }
 
 void CompressedGraph::build_varint() const {
-    ensure_csr();
-    varint_offsets_.assign(adj_lists_.size() + 1, 0);
-    neighbors_varint_.clear();
-    neighbors_varint_.reserve(neighbors_.size());
-    varint_offsets_[0] = 0;
-    for (size_t u = 0; u < adj_lists_.size(); ++u) {
+    if (compressed_only_) return compact(); // the varint rows are the base; fold pending edits into them
+    TOPSORT_PHASE("varint_build");
+    TOPSORT_COUNT(kVarintBuilds, 1);
+    CsrView view = snapshot();
+    const uint32_t *offsets = view.offsets();
+    const node_t *neighbors = view.neighbors();
+    auto data = std::make_shared<VarintData>();
+    data->offsets.assign(n_ + 1, 0);
+    data->bytes.reserve(view.edge_count() + kVarintPadding);
+    for (size_t u = 0; u < n_; ++u) {
         uint32_t prev = 0;
         bool first = true;
-        for (size_t idx = offsets_[u]; idx < offsets_[u + 1]; ++idx) {
-            uint32_t v = neighbors_[idx];
+        for (size_t idx = offsets[u]; idx < offsets[u + 1]; ++idx) {
+            uint32_t v = neighbors[idx];
             uint32_t delta = first ? v : (v - prev);
-            encode_varint32(delta, neighbors_varint_);
+            encode_varint32(delta, data->bytes);
             prev = v;
             first = false;
         }
-        varint_offsets_[u + 1] = static_cast<uint32_t>(neighbors_varint_.size());
-    }
-}
-
-void CompressedGraph::for_each_neighbor_varint(node_t u, const std::function<void(node_t)> &fn) const {
-    if (varint_offsets_.empty()) build_varint();
-    const uint8_t *beg = neighbors_varint_.data() + varint_offsets_[u];
-    const uint8_t *end = neighbors_varint_.data() + varint_offsets_[u + 1];
-    uint32_t prev = 0;
-    bool first = true;
-    const uint8_t *ptr = beg;
-    while (ptr < end) {
-        uint32_t delta = decode_varint32(ptr, end);
-        uint32_t v = first ? delta : prev + delta;
-        fn(v);
-        prev = v;
-        first = false;
+        data->offsets[u + 1] = static_cast<uint32_t>(data->bytes.size());
     }
+    data->bytes.resize(data->bytes.size() + kVarintPadding, 0);
+    data->bytes.shrink_to_fit();
+    varint_ = std::move(data);
 }
 
 void CompressedGraph::export_csr(std::vector<uint32_t> &offsets, std::vector<node_t> &neighbors) const {
-    ensure_csr();
-    offsets = offsets_;
-    neighbors = neighbors_;
+    CsrView view = snapshot();
+    offsets.assign(view.offsets(), view.offsets() + n_ + 1);
+    neighbors.assign(view.neighbors(), view.neighbors() + view.edge_count());
 }
@@ -1,9 +1,11 @@
 #pragma once
 
+#include "instrument.hpp"
+
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
-#include <functional>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -13,6 +15,8 @@
 class SpinLock {
 public:
     void lock() {
+        if (!flag_.test_and_set(std::memory_order_acquire)) return;
+        TOPSORT_COUNT(kSpinContended, 1);
         while (flag_.test_and_set(std::memory_order_acquire)) {}
     }
     void unlock() { flag_.clear(std::memory_order_release); }
@@ -29,15 +33,41 @@ private:
 };
 
 // Lightweight graph interface so solvers stay decoupled from storage.
+// Hot loops should not go through this vtable per edge: see topo_kernels.hpp for statically-dispatched solvers.
 class GraphInterface {
 public:
     using node_t = uint32_t;
     virtual ~GraphInterface() = default;
     virtual size_t node_count() const = 0;
-    // Neighbor iteration is cache-friendly and thread-safe as long as the graph is not mutated.
-    virtual void for_each_neighbor(node_t u, const std::function<void(node_t)> &fn) const = 0;
     // Fast contiguous neighbor span; {begin, end} over an internal CSR buffer.
     virtual std::pair<const node_t *, const node_t *> neighbor_span(node_t u) const = 0;
+
+    // Neighbor iteration is cache-friendly and thread-safe as long as the graph is not mutated.
+    // One virtual call per node; fn is a template parameter so the per-edge call inlines.
+    template <class Fn>
+    void for_each_neighbor(node_t u, Fn &&fn) const {
+        auto span = neighbor_span(u);
+        for (auto it = span.first; it != span.second; ++it) fn(*it);
+    }
+
+    // Resumable position in one node's neighbor list, for walks that interleave rows (DFS). pos/end are storage
+    // specific (edge index, byte offset, ...); prev carries decoder state. Concrete graphs shadow row_cursor and
+    // next_neighbor with direct versions; this fallback re-fetches the span on every step.
+    struct RowCursor {
+        node_t node;
+        uint32_t pos;
+        uint32_t end;
+        uint32_t prev;
+    };
+    RowCursor row_cursor(node_t u) const {
+        auto span = neighbor_span(u);
+        return RowCursor{u, 0, static_cast<uint32_t>(span.second - span.first), 0};
+    }
+    bool next_neighbor(RowCursor &c, node_t &v) const {
+        if (c.pos == c.end) return false;
+        v = neighbor_span(c.node).first[c.pos++];
+        return true;
+    }
 };
 
 // Bidirectional index for mapping external node labels to dense ids and back.
@@ -52,51 +82,318 @@ private:
     std::vector<std::string> labels_;
 };
 
-// CSR with optional varint-compressed backing store. Reads are thread-safe; writes are not.
-class CompressedGraph : public GraphInterface {
+// Minimal varint helpers (7-bit groups, LEB128-compatible for uint32_t).
+size_t encode_varint32(uint32_t value, std::vector<uint8_t> &out);
+uint32_t decode_varint32(const uint8_t *&ptr, const uint8_t *end);
+// Bulk decode of a delta-coded run: reads up to max_values varints from [ptr, end), writes base + running sum to out,
+// advances ptr and returns the count. Vectorized with SSE2/AVX2 when available (varint_decode.cpp); `limit`, if given,
+// is how far the decoder may read (never write) past `end`, which lets short rows in a padded buffer use 16-byte loads.
+size_t decode_varint_deltas(const uint8_t *&ptr, const uint8_t *end, uint32_t base, uint32_t *out, size_t max_values,
+                            const uint8_t *limit = nullptr);
+// Zero bytes build_varint() keeps after the last row so that decode_varint_deltas can always read a full window.
+constexpr size_t kVarintPadding = 16;
+// Ids decoded per bulk step when walking a varint row.
+constexpr size_t kVarintDecodeBlock = 64;
+
+// Walk one delta-coded row [ptr, end); bytes up to `limit` are readable. Short rows stay on an inline scalar loop,
+// longer ones go through decode_varint_deltas in blocks on the stack, so concurrent callers need no shared scratch.
+template <class Fn>
+void for_each_varint_row(const uint8_t *ptr, const uint8_t *end, const uint8_t *limit, Fn &&fn) {
+    uint32_t prev = 0; // first delta is relative to 0
+    if (end - ptr < static_cast<std::ptrdiff_t>(kVarintPadding)) {
+        while (ptr < end) {
+            if (*ptr < 0x80u) prev += *ptr++;
+            else prev += decode_varint32(ptr, end);
+            fn(prev);
+        }
+        return;
+    }
+    uint32_t buf[kVarintDecodeBlock];
+    while (ptr < end) {
+        size_t got = decode_varint_deltas(ptr, end, prev, buf, kVarintDecodeBlock, limit);
+        for (size_t i = 0; i < got; ++i) fn(buf[i]);
+        prev = buf[got - 1];
+    }
+}
+
+// Immutable CSR arrays shared between a CompressedGraph and the CsrViews taken from it.
+struct CsrData {
+    std::vector<uint32_t> offsets;        // size n+1
+    std::vector<GraphInterface::node_t> neighbors;
+};
+
+// Frozen read-only CSR snapshot (of a CompressedGraph, or of a memory-mapped binary graph). neighbor_span is a pure
+// two-load offset lookup (no dirty check, no lock), so any number of threads may read one view concurrently. The
+// view holds a reference on whatever owns the arrays, so they stay alive and unchanged even if the source graph is
+// later mutated, republished, or destroyed.
+class CsrView final : public GraphInterface {
+public:
+    using node_t = GraphInterface::node_t;
+    CsrView() = default;
+    explicit CsrView(std::shared_ptr<const CsrData> data)
+        : CsrView(data, data->offsets.data(), data->neighbors.data(), data->offsets.empty() ? 0 : data->offsets.size() - 1) {}
+    // Borrow external arrays (offsets has n+1 entries); `owner` keeps them alive.
+    CsrView(std::shared_ptr<const void> owner, const uint32_t *offsets, const node_t *neighbors, size_t n)
+        : owner_(std::move(owner)), offsets_(offsets), neighbors_(neighbors), n_(n) {}
+
+    size_t node_count() const override { return n_; }
+    std::pair<const node_t *, const node_t *> neighbor_span(node_t u) const override {
+        return {neighbors_ + offsets_[u], neighbors_ + offsets_[u + 1]};
+    }
+    template <class Fn>
+    void for_each_neighbor(node_t u, Fn &&fn) const {
+        auto span = neighbor_span(u);
+        for (auto it = span.first; it != span.second; ++it) fn(*it);
+    }
+    RowCursor row_cursor(node_t u) const { return RowCursor{u, offsets_[u], offsets_[u + 1], 0}; }
+    bool next_neighbor(RowCursor &c, node_t &v) const {
+        if (c.pos == c.end) return false;
+        v = neighbors_[c.pos++];
+        return true;
+    }
+
+    size_t edge_count() const { return n_ == 0 ? 0 : offsets_[n_]; }
+    const uint32_t *offsets() const { return offsets_; }   // n+1 entries
+    const node_t *neighbors() const { return neighbors_; } // edge_count() entries
+
+private:
+    std::shared_ptr<const void> owner_{};
+    const uint32_t *offsets_{nullptr};
+    const node_t *neighbors_{nullptr};
+    size_t n_{0};
+};
+
+// Delta-coded varint rows (see CompressedGraph::build_varint); bytes ends with kVarintPadding zero bytes.
+struct VarintData {
+    std::vector<uint8_t> bytes;
+    std::vector<uint32_t> offsets; // size n+1, byte offsets into bytes
+};
+
+// Read-only graph over varint rows, decoded on the fly; the compressed counterpart of CsrView, with the same
+// lifetime rules. for_each_neighbor and row cursors decode into caller-side state and are safe from any number of
+// threads. neighbor_span has to materialize the row, so it decodes into a scratch buffer owned by the view: the span
+// lasts until the next neighbor_span call, and that call is not thread-safe on a shared view. Kernels avoid it.
+class VarintView final : public GraphInterface {
+public:
+    using node_t = GraphInterface::node_t;
+    VarintView() = default;
+    explicit VarintView(std::shared_ptr<const VarintData> data)
+        : VarintView(data, data->offsets.data(), data->bytes.data(), data->bytes.size(),
+                     data->offsets.empty() ? 0 : data->offsets.size() - 1) {}
+    // Borrow external arrays (offsets has n+1 entries, bytes has byte_count); `owner` keeps them alive.
+    VarintView(std::shared_ptr<const void> owner, const uint32_t *offsets, const uint8_t *bytes, size_t byte_count,
+               size_t n)
+        : owner_(std::move(owner)), offsets_(offsets), bytes_(bytes), byte_count_(byte_count), n_(n) {}
+
+    size_t node_count() const override { return n_; }
+    std::pair<const node_t *, const node_t *> neighbor_span(node_t u) const override;
+    template <class Fn>
+    void for_each_neighbor(node_t u, Fn &&fn) const {
+        for_each_varint_row(bytes_ + offsets_[u], bytes_ + offsets_[u + 1], bytes_ + byte_count_, fn);
+    }
+    RowCursor row_cursor(node_t u) const { return RowCursor{u, offsets_[u], offsets_[u + 1], 0}; }
+    bool next_neighbor(RowCursor &c, node_t &v) const {
+        if (c.pos == c.end) return false;
+        const uint8_t *p = bytes_ + c.pos;
+        if (*p < 0x80u) {
+            c.prev += *p;
+            ++c.pos;
+        } else {
+            c.prev += decode_varint32(p, bytes_ + c.end);
+            c.pos = static_cast<uint32_t>(p - bytes_);
+        }
+        v = c.prev;
+        return true;
+    }
+
+    const uint32_t *offsets() const { return offsets_; } // n+1 entries
+    const uint8_t *bytes() const { return bytes_; }
+    size_t byte_count() const { return byte_count_; }
+
+private:
+    std::shared_ptr<const void> owner_{};
+    const uint32_t *offsets_{nullptr};
+    const uint8_t *bytes_{nullptr};
+    size_t byte_count_{0};
+    size_t n_{0};
+    mutable std::vector<node_t> scratch_{};
+};
+
+// CSR with optional varint-compressed backing store under a write overlay. The base (the published CSR, or the varint
+// rows in compressed-only mode) is immutable; add_edge/remove_edge/add_node/remove_node record per-row deltas on top
+// of it, and reads merge base and delta rows, so edits never rebuild anything on the read path. Once the overlay has
+// grown to a quarter of the base it is compacted into a fresh base, keeping the cost per edit amortized O(1).
+// Single writer. Threads other than the writer read through published(), which only ever sees compacted bases swapped
+// in atomically; the writer (or single-threaded code) may read the live graph directly or take snapshot(), which
+// compacts pending edits first.
+// release_dense() switches to compressed-only mode: the dense CSR is freed and only the varint rows, the overlay and
+// indegrees stay resident; visit_graph then hands solvers a VarintView. Edits keep the mode and compact into varint rows.
+// Final so that code holding a CompressedGraph calls neighbor_span without a vtable.
+class CompressedGraph final : public GraphInterface {
 public:
     using node_t = GraphInterface::node_t;
     CompressedGraph() = default;
     explicit CompressedGraph(size_t n) { reset(n); }
 
     void reset(size_t n);
+    // Bulk builds go straight to a published, row-sorted, deduplicated CSR (see csr_builder.hpp) with an empty overlay.
     void build_from_adj(const std::vector<std::vector<node_t>> &adj);
     void build_from_edges(size_t n, const std::vector<std::pair<node_t, node_t>> &edges);
+    // Adopt CSR arrays whose rows are already sorted and deduplicated (e.g. from relabel_csr).
+    void build_from_csr(CsrData csr);
 
-    // Mutating edge insertion for incremental use cases; invalidates CSR cache until next read.
+    // Edge insertion for incremental use cases; recorded in the overlay. Adjacency is a set, so repeats are ignored.
     void add_edge(node_t u, node_t v);
+    // Returns false if the edge was not present.
+    bool remove_edge(node_t u, node_t v);
+    bool has_edge(node_t u, node_t v) const;
+    // Append an isolated node; returns its id.
+    node_t add_node();
+    // Remove u and its edges, keeping ids dense: the last node (id n-1) is renamed to u. Returns the old id of the node
+    // now at u (u itself if it was last). In-edges are found by scanning every row, which is skipped when indegrees
+    // say there are none; callers that know the predecessors can strip those edges first to keep this O(degree).
+    node_t remove_node(node_t u);
 
-    size_t node_count() const override { return adj_lists_.size(); }
-    void for_each_neighbor(node_t u, const std::function<void(node_t)> &fn) const override;
-    std::pair<const node_t *, const node_t *> neighbor_span(node_t u) const override;
+    // Fold the overlay into a fresh base now: a new published CSR, or new varint rows in compressed-only mode.
+    void compact() const;
+    // Compact pending edits (if any) and atomically publish the CSR for snapshot() and published(). No-op in
+    // compressed-only mode.
+    void publish() const;
+    // Writer-side: publishes pending edits, then returns the current CSR. In compressed-only mode this decodes a
+    // temporary dense copy that only the returned view owns.
+    CsrView snapshot() const;
+    // Reader-side: last published CSR via an atomic load; never rebuilds, safe against a concurrent writer. Empty in
+    // compressed-only mode.
+    CsrView published() const;
+    // Varint rows as a solver-ready view (compacts and builds them first if needed).
+    VarintView varint_view() const;
+
+    // Compressed-only mode: build the varint rows if needed, then free the dense CSR.
+    void release_dense();
+    bool compressed_only() const { return compressed_only_; }
+
+    size_t node_count() const override { return n_; }
+    // Structural fingerprint (graph_fingerprint in hash.hpp): equal for equal node counts and edge sets, whatever the
+    // build path or edit history. Kept current by add_edge / remove_edge in O(1) and computed in parallel by bulk
+    // builds; remove_node renames edges, so the first call after one rehashes the graph.
+    uint64_t fingerprint() const;
+    // Rows with pending edits, and every row in compressed-only mode, are merged into a scratch buffer that the next
+    // call overwrites; other rows point into the base CSR.
+    std::pair<const node_t *, const node_t *> neighbor_span(node_t u) const override {
+        if (dirty_.load(std::memory_order_acquire)) return neighbor_span_slow(u);
+        return {neighbors_ + offsets_[u], neighbors_ + offsets_[u + 1]};
+    }
+    // Merged walk over the base row and its delta, in ascending order; never compacts, so the writer can interleave
+    // it with edits. Rows without edits cost one extra branch.
+    template <class Fn>
+    void for_each_neighbor(node_t u, Fn &&fn) const {
+        const RowDelta *d = delta_of(u);
+        if (d == nullptr) return for_each_base_neighbor(u, fn);
+        auto add = d->added.begin(), add_end = d->added.end();
+        if (!d->replaced) {
+            auto del = d->removed.begin(), del_end = d->removed.end();
+            for_each_base_neighbor(u, [&](node_t v) {
+                while (add != add_end && *add < v) fn(*add++);
+                if (del != del_end && *del == v) {
+                    ++del;
+                    return;
+                }
+                fn(v);
+            });
+        }
+        while (add != add_end) fn(*add++);
+    }
 
     // Varint-backed neighbor scan (delta-coded, ascending adjacency required).
     void build_varint() const;
-    void for_each_neighbor_varint(node_t u, const std::function<void(node_t)> &fn) const;
+    template <class Fn>
+    void for_each_neighbor_varint(node_t u, Fn &&fn) const {
+        if (!varint_ || overlay_entries_ != 0) build_varint();
+        const VarintData &vd = *varint_;
+        const uint8_t *base = vd.bytes.data();
+        for_each_varint_row(base + vd.offsets[u], base + vd.offsets[u + 1], base + vd.bytes.size(), fn);
+    }
+
+    // Raw varint buffers as built by build_varint() (empty until then); the data ends with kVarintPadding zero bytes
+    // past varint_offsets()[n].
+    const std::vector<uint8_t> &varint_data() const;
+    const std::vector<uint32_t> &varint_offsets() const;
 
     void export_csr(std::vector<uint32_t> &offsets, std::vector<node_t> &neighbors) const;
 
     const std::vector<uint32_t> &indegrees() const { return indeg_; }
-    size_t dense_bytes() const { return neighbors_.size() * sizeof(node_t) + offsets_.size() * sizeof(uint32_t); }
-    size_t varint_bytes() const { return neighbors_varint_.size() + varint_offsets_.size() * sizeof(uint32_t); }
+    // Resident (allocated) bytes: dense_bytes covers the CSR arrays, varint_bytes the varint rows and their offsets,
+    // overlay_bytes the pending edits; each is 0 for a representation that is not currently held.
+    size_t dense_bytes() const;
+    size_t varint_bytes() const;
+    size_t overlay_bytes() const;
 
 private:
-    void ensure_csr() const;
-    void rebuild_csr_unlocked() const;
+    // The overlay is compacted once it holds more than max(kMinCompactEntries, (base edges + rows) / kCompactDivisor)
+    // edits.
+    static constexpr size_t kCompactDivisor = 4;
+    static constexpr size_t kMinCompactEntries = 1024;
+
+    // Edits to one row relative to the base. The row is (replaced ? {} : base row minus removed) plus added; both lists
+    // are sorted, removed is a subset of the base row and added is disjoint from what remains of it.
+    struct RowDelta {
+        node_t node;
+        bool replaced;
+        std::vector<node_t> added;
+        std::vector<node_t> removed;
+    };
+
+    const RowDelta *delta_of(node_t u) const {
+        return delta_index_.empty() || delta_index_[u] == 0 ? nullptr : &deltas_[delta_index_[u] - 1];
+    }
+    template <class Fn>
+    void for_each_base_neighbor(node_t u, Fn &&fn) const {
+        if (compressed_only_) {
+            const VarintData &vd = *varint_;
+            const uint8_t *base = vd.bytes.data();
+            for_each_varint_row(base + vd.offsets[u], base + vd.offsets[u + 1], base + vd.bytes.size(), fn);
+            return;
+        }
+        for (const node_t *it = neighbors_ + offsets_[u], *end = neighbors_ + offsets_[u + 1]; it != end; ++it) fn(*it);
+    }
+    void ensure_csr() const {
+        if (dirty_.load(std::memory_order_acquire)) publish();
+    }
+    std::pair<const node_t *, const node_t *> neighbor_span_slow(node_t u) const;
+    bool row_contains(node_t u, node_t v) const;
+    RowDelta &touch_row(node_t u);
+    void row_insert(node_t u, node_t v);
+    void row_erase(node_t u, node_t v);
+    void drop_delta(node_t u);
+    void note_edit();
+    void clear_overlay() const;
+    void compact_unlocked() const;
+    void install_csr(std::shared_ptr<CsrData> data) const;
+    void adopt_csr(std::shared_ptr<CsrData> data);
 
-    std::vector<std::vector<node_t>> adj_lists_{}; // mutable adjacency for incremental updates
-    mutable std::vector<node_t> neighbors_{};       // CSR neighbors (dense)
-    mutable std::vector<uint32_t> offsets_{};       // CSR offsets (size n+1)
+    size_t n_{0};
     std::vector<uint32_t> indeg_{};
+    mutable uint64_t edge_hash_sum_{0};
+    mutable bool edge_hash_stale_{false};
 
-    // Varint buffers (built on demand from CSR).
-    mutable std::vector<uint8_t> neighbors_varint_{};
-    mutable std::vector<uint32_t> varint_offsets_{};
+    // Published CSR; swapped with std::atomic_store so snapshot() never observes a half-built buffer.
+    mutable std::shared_ptr<const CsrData> csr_{};
+    mutable const uint32_t *offsets_{nullptr};      // raw views into csr_ for the writer-side neighbor_span
+    mutable const node_t *neighbors_{nullptr};
 
-    mutable SpinLock csr_lock_{};
-    mutable bool dirty_{true};
-};
+    // Varint rows (built on demand from CSR); the base in compressed-only mode.
+    mutable std::shared_ptr<const VarintData> varint_{};
+    bool compressed_only_{false};
+    mutable std::vector<node_t> scratch_{};         // neighbor_span rows merged or decoded on the slow path
 
-// Minimal varint helpers (7-bit groups, LEB128-compatible for uint32_t).
-size_t encode_varint32(uint32_t value, std::vector<uint8_t> &out);
-uint32_t decode_varint32(const uint8_t *&ptr, const uint8_t *end);
+    // Overlay: delta_index_ is empty or has one entry per node, 0 for an untouched row and k for deltas_[k - 1].
+    mutable std::vector<RowDelta> deltas_{};
+    mutable std::vector<uint32_t> delta_index_{};
+    mutable size_t overlay_entries_{0};             // edits since the last compaction
+    mutable size_t base_edges_{0};                  // edge count of the base, for the compaction threshold
+
+    mutable SpinLock csr_lock_{};                   // serializes compactions only; readers never take it
+    // Set while the overlay is non-empty and held true in compressed-only mode, so neighbor_span takes its slow path
+    // with a single flag check.
+    mutable std::atomic<bool> dirty_{true};
+};
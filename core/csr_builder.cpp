@@ -0,0 +1,198 @@
+#include "csr_builder.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+// Rows are handed out in blocks so a few heavy rows cannot stall one static partition.
+constexpr size_t kRowBlock = 1024;
+// Below this size thread start-up dominates; run the same code on one worker.
+constexpr size_t kParallelCutoff = 1u << 16;
+
+size_t effective_workers(size_t work, size_t workers) {
+    return work < kParallelCutoff ? 1 : std::max<size_t>(1, workers);
+}
+
+template <class T>
+std::unique_ptr<std::atomic<T>[]> make_atomic_array(size_t n, size_t workers) {
+    std::unique_ptr<std::atomic<T>[]> a(new std::atomic<T>[n]);
+    parallel_for(n, workers, [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) a[i].store(0, std::memory_order_relaxed);
+    });
+    return a;
+}
+}
+
+void parallel_exclusive_scan(const std::vector<uint32_t> &counts, std::vector<uint32_t> &out, size_t workers) {
+    size_t n = counts.size();
+    out.resize(n + 1);
+    out[0] = 0;
+    workers = std::max<size_t>(1, std::min(effective_workers(n, workers), n));
+    if (workers == 1) {
+        uint64_t run = 0;
+        for (size_t i = 0; i < n; ++i) {
+            run += counts[i];
+            if (run > UINT32_MAX) throw std::length_error("edge count exceeds 32-bit CSR offsets");
+            out[i + 1] = static_cast<uint32_t>(run);
+        }
+        return;
+    }
+    std::vector<uint64_t> block_sum(workers + 1, 0);
+    parallel_for(n, workers, [&](size_t w, size_t b, size_t e) {
+        uint64_t s = 0;
+        for (size_t i = b; i < e; ++i) s += counts[i];
+        block_sum[w + 1] = s;
+    });
+    for (size_t w = 0; w < workers; ++w) block_sum[w + 1] += block_sum[w];
+    if (block_sum[workers] > UINT32_MAX) throw std::length_error("edge count exceeds 32-bit CSR offsets");
+    parallel_for(n, workers, [&](size_t w, size_t b, size_t e) {
+        uint32_t run = static_cast<uint32_t>(block_sum[w]);
+        for (size_t i = b; i < e; ++i) {
+            run += counts[i];
+            out[i + 1] = run;
+        }
+    });
+}
+
+void sort_dedup_rows(CsrData &csr, size_t workers) {
+    size_t n = csr.offsets.empty() ? 0 : csr.offsets.size() - 1;
+    if (n == 0) return;
+    workers = effective_workers(csr.neighbors.size(), workers);
+    std::vector<uint32_t> kept(n, 0);
+    std::atomic<size_t> next_block{0};
+    std::atomic<bool> shrunk{false};
+    run_workers(workers, [&](size_t) {
+        for (;;) {
+            size_t b = next_block.fetch_add(kRowBlock, std::memory_order_relaxed);
+            if (b >= n) break;
+            size_t e = std::min(b + kRowBlock, n);
+            for (size_t u = b; u < e; ++u) {
+                auto first = csr.neighbors.begin() + csr.offsets[u];
+                auto last = csr.neighbors.begin() + csr.offsets[u + 1];
+                std::sort(first, last);
+                auto end = std::unique(first, last);
+                kept[u] = static_cast<uint32_t>(end - first);
+                if (end != last) shrunk.store(true, std::memory_order_relaxed);
+            }
+        }
+    });
+    if (!shrunk.load()) return;
+
+    // Left-shift rows into their deduplicated positions. Destinations never pass their sources, so one forward
+    // sequential sweep is safe in place; a parallel sweep would need a second neighbor array.
+    std::vector<uint32_t> new_offsets;
+    parallel_exclusive_scan(kept, new_offsets, workers);
+    for (size_t u = 0; u < n; ++u) {
+        auto src = csr.neighbors.begin() + csr.offsets[u];
+        std::copy(src, src + kept[u], csr.neighbors.begin() + new_offsets[u]);
+    }
+    csr.neighbors.resize(new_offsets[n]);
+    csr.neighbors.shrink_to_fit();
+    csr.offsets.swap(new_offsets);
+}
+
+namespace {
+// Single-worker path. Plain increments matter here: a locked RMW that misses cache stalls the pipeline, whereas
+// ordinary loads/stores let the core overlap many outstanding misses on the random-access passes.
+void build_csr_sequential(size_t n, const std::pair<GraphInterface::node_t, GraphInterface::node_t> *edges, size_t m,
+                          CsrData &out) {
+    std::vector<uint32_t> cursor(n, 0);
+    for (size_t i = 0; i < m; ++i) {
+        if (edges[i].first >= n || edges[i].second >= n) throw std::out_of_range("edge endpoint out of bounds");
+        cursor[edges[i].first]++;
+    }
+    parallel_exclusive_scan(cursor, out.offsets, 1);
+    std::copy(out.offsets.begin(), out.offsets.end() - 1, cursor.begin());
+    out.neighbors.clear();
+    out.neighbors.resize(m);
+    for (size_t i = 0; i < m; ++i) out.neighbors[cursor[edges[i].first]++] = edges[i].second;
+}
+}
+
+void build_csr_from_edges(size_t n, const std::pair<GraphInterface::node_t, GraphInterface::node_t> *edges, size_t m,
+                          CsrData &out, size_t workers) {
+    workers = effective_workers(m, workers);
+    if (workers == 1) {
+        build_csr_sequential(n, edges, m, out);
+        sort_dedup_rows(out, 1);
+        return;
+    }
+
+    // (1) out-degrees; the same array later serves as the scatter cursor.
+    auto cursor = make_atomic_array<uint32_t>(n, workers);
+    std::atomic<bool> bad{false};
+    parallel_for(m, workers, [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            if (edges[i].first >= n || edges[i].second >= n) {
+                bad.store(true, std::memory_order_relaxed);
+                continue;
+            }
+            cursor[edges[i].first].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    if (bad.load()) throw std::out_of_range("edge endpoint out of bounds");
+
+    // (2) offsets
+    std::vector<uint32_t> degree(n);
+    parallel_for(n, workers, [&](size_t, size_t b, size_t e) {
+        for (size_t u = b; u < e; ++u) degree[u] = cursor[u].load(std::memory_order_relaxed);
+    });
+    parallel_exclusive_scan(degree, out.offsets, workers);
+    std::vector<uint32_t>().swap(degree);
+
+    // (3) scatter
+    parallel_for(n, workers, [&](size_t, size_t b, size_t e) {
+        for (size_t u = b; u < e; ++u) cursor[u].store(out.offsets[u], std::memory_order_relaxed);
+    });
+    out.neighbors.clear();
+    out.neighbors.resize(m);
+    parallel_for(m, workers, [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            uint32_t pos = cursor[edges[i].first].fetch_add(1, std::memory_order_relaxed);
+            out.neighbors[pos] = edges[i].second;
+        }
+    });
+    cursor.reset();
+
+    // (4) rows are in arbitrary order after the scatter
+    sort_dedup_rows(out, workers);
+}
+
+void csr_indegrees(const CsrData &csr, std::vector<uint32_t> &indeg, size_t workers) {
+    size_t n = csr.offsets.empty() ? 0 : csr.offsets.size() - 1;
+    workers = effective_workers(csr.neighbors.size(), workers);
+    if (workers == 1) {
+        indeg.assign(n, 0);
+        for (auto v : csr.neighbors) indeg[v]++;
+        return;
+    }
+    auto counts = make_atomic_array<uint32_t>(n, workers);
+    parallel_for(csr.neighbors.size(), workers, [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) counts[csr.neighbors[i]].fetch_add(1, std::memory_order_relaxed);
+    });
+    indeg.resize(n);
+    parallel_for(n, workers, [&](size_t, size_t b, size_t e) {
+        for (size_t u = b; u < e; ++u) indeg[u] = counts[u].load(std::memory_order_relaxed);
+    });
+}
+
+uint64_t csr_edge_hash_sum(const uint32_t *offsets, const GraphInterface::node_t *neighbors, size_t n,
+                           size_t workers) {
+    auto row_sum = [&](size_t b, size_t e) {
+        uint64_t sum = 0;
+        for (size_t u = b; u < e; ++u) {
+            for (uint32_t i = offsets[u]; i < offsets[u + 1]; ++i) sum += edge_hash(static_cast<uint32_t>(u), neighbors[i]);
+        }
+        return sum;
+    };
+    workers = effective_workers(n == 0 ? 0 : offsets[n], workers);
+    if (workers == 1) return row_sum(0, n);
+    std::vector<uint64_t> partial(std::min(workers, n), 0);
+    parallel_for(n, workers, [&](size_t w, size_t b, size_t e) { partial[w] = row_sum(b, e); });
+    uint64_t sum = 0;
+    for (uint64_t p : partial) sum += p;
+    return sum;
+}
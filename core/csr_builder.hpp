@@ -0,0 +1,36 @@
+#pragma once
+
+#include "compressed_graph.hpp"
+#include "parallel.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Direct edges -> CSR construction, without an intermediate vector-of-vectors:
+// (1) parallel degree count with atomic increments, (2) parallel exclusive prefix sum for offsets, (3) scatter through
+// atomic per-row cursors, (4) parallel per-row sort + dedup, then a single in-place compaction if anything was removed.
+// Extra memory on top of the final CSR is one 32-bit cursor per node. With one worker the same passes run with plain
+// (non-atomic) counters. Throws std::out_of_range on a bad endpoint.
+void build_csr_from_edges(size_t n, const std::pair<GraphInterface::node_t, GraphInterface::node_t> *edges, size_t m,
+                          CsrData &out, size_t workers = default_worker_count());
+
+inline void build_csr_from_edges(size_t n, const std::vector<std::pair<GraphInterface::node_t, GraphInterface::node_t>> &edges,
+                                 CsrData &out, size_t workers = default_worker_count()) {
+    build_csr_from_edges(n, edges.data(), edges.size(), out, workers);
+}
+
+// Sort and dedup each row of an already-grouped CSR in parallel, then compact rows in place and fix offsets.
+void sort_dedup_rows(CsrData &csr, size_t workers = default_worker_count());
+
+// out[0] = 0, out[i + 1] = out[i] + counts[i]; blocked two-pass scan over workers. out is resized to counts.size() + 1.
+void parallel_exclusive_scan(const std::vector<uint32_t> &counts, std::vector<uint32_t> &out,
+                             size_t workers = default_worker_count());
+
+// Sum of edge_hash (hash.hpp) over every edge of rows [0, n), in parallel.
+uint64_t csr_edge_hash_sum(const uint32_t *offsets, const GraphInterface::node_t *neighbors, size_t n,
+                           size_t workers = default_worker_count());
+
+// Indegree of every node of a CSR, counted in parallel.
+void csr_indegrees(const CsrData &csr, std::vector<uint32_t> &indeg, size_t workers = default_worker_count());
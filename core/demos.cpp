@@ -1,4 +1,5 @@
 #include "demos.hpp"
+#include "parallel.hpp"
 
 namespace {
 DemoResult solve_demo(size_t n,
@@ -12,9 +13,16 @@ DemoResult solve_demo(size_t n,
     if (algo == "dfs") {
         DFSTopoSolver solver(g);
         r.has_cycle = solver.run(r.order);
-    } else if (algo == "kahn" || algo == "parallel") {
+    } else if (algo == "kahn") {
         KahnTopoSolver solver(g);
         r.has_cycle = solver.run(r.order);
+    } else if (algo == "parallel") {
+        ParallelKahnSolver solver(g, default_worker_count());
+        r.has_cycle = solver.run(r.order);
+    } else if (algo == "layered") {
+        LayeredTopoSolver solver(g, default_worker_count());
+        r.has_cycle = solver.run_levels(r.levels);
+        r.order = r.levels.nodes;
     } else if (algo == "lexi_min") {
         LexicographicKahnSolver solver(g, true);
         r.has_cycle = solver.run(r.order);
@@ -43,17 +51,30 @@ CourseScheduler CourseScheduler::Sample() {
     return CourseScheduler(n, e);
 }
 
-TaskDependencyManager::TaskDependencyManager(size_t task_count, const std::vector<std::pair<uint32_t, uint32_t>> &edges)
-    : n_(task_count), edges_(edges) {}
+TaskDependencyManager::TaskDependencyManager(size_t task_count, const std::vector<std::pair<uint32_t, uint32_t>> &edges,
+                                             std::vector<uint32_t> durations)
+    : n_(task_count), edges_(edges), durations_(std::move(durations)) {}
 
 DemoResult TaskDependencyManager::run(const std::string &algo) { return solve_demo(n_, edges_, algo); }
 
+CriticalPathResult TaskDependencyManager::critical_path(size_t workers) const {
+    CompressedGraph g;
+    g.build_from_edges(n_, edges_);
+    return ::critical_path(g, durations_, workers);
+}
+
+ScheduleResult TaskDependencyManager::schedule(size_t processors, PriorityRule rule) const {
+    CompressedGraph g;
+    g.build_from_edges(n_, edges_);
+    return list_schedule(g, durations_, processors, rule);
+}
+
 TaskDependencyManager TaskDependencyManager::Sample() {
     size_t n = 7;
     std::vector<std::pair<uint32_t, uint32_t>> e = {
         {0, 3}, {1, 3}, {1, 4}, {3, 5}, {4, 5}, {5, 6}
     };
-    return TaskDependencyManager(n, e);
+    return TaskDependencyManager(n, e, {3, 1, 2, 4, 6, 2, 1});
 }
 
 PackageResolver::PackageResolver(size_t pkg_count, const std::vector<std::pair<uint32_t, uint32_t>> &edges)
@@ -61,6 +82,28 @@ PackageResolver::PackageResolver(size_t pkg_count, const std::vector<std::pair<u
 
 DemoResult PackageResolver::run(const std::string &algo) { return solve_demo(n_, edges_, algo); }
 
+ReductionResult PackageResolver::reduce(std::vector<std::pair<uint32_t, uint32_t>> &edges) const {
+    CompressedGraph g;
+    g.build_from_edges(n_, edges_);
+    CompressedGraph reduced;
+    ReductionResult r = transitive_reduction(g, reduced);
+    edges.clear();
+    if (r.has_cycle) return r;
+    for (uint32_t u = 0; u < n_; ++u) {
+        reduced.for_each_neighbor(u, [&](uint32_t v) { edges.emplace_back(u, v); });
+    }
+    return r;
+}
+
+bool PackageResolver::depends_on(uint32_t pkg, uint32_t dep) {
+    if (!reach_) {
+        CompressedGraph g;
+        g.build_from_edges(n_, edges_);
+        reach_ = std::make_shared<const ReachabilityIndex>(g);
+    }
+    return reach_->reaches(dep, pkg);
+}
+
 PackageResolver PackageResolver::Sample() {
     size_t n = 6;
     std::vector<std::pair<uint32_t, uint32_t>> e = {
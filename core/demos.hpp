@@ -2,6 +2,8 @@
 
 #include "compressed_graph.hpp"
 #include "layout.hpp"
+#include "reachability.hpp"
+#include "schedule.hpp"
 #include "toposort.hpp"
 
 #include <memory>
@@ -13,6 +15,7 @@ struct DemoResult {
     bool has_cycle{false};
     std::vector<uint32_t> order;
     std::vector<LayoutPoint> layout;
+    TopoLevels levels; // filled by algo "layered": the schedule, level by level
 };
 
 class CourseScheduler {
@@ -27,22 +30,36 @@ private:
 
 class TaskDependencyManager {
 public:
-    TaskDependencyManager(size_t task_count, const std::vector<std::pair<uint32_t, uint32_t>> &edges);
+    // durations[t] is the run time of task t; empty means every task takes 1.
+    TaskDependencyManager(size_t task_count, const std::vector<std::pair<uint32_t, uint32_t>> &edges,
+                          std::vector<uint32_t> durations = {});
     DemoResult run(const std::string &algo);
+    // Earliest / latest start, slack and one critical chain (see schedule.hpp).
+    CriticalPathResult critical_path(size_t workers = default_worker_count()) const;
+    // Simulated run on `processors` workers; reports makespan and per-worker assignments.
+    ScheduleResult schedule(size_t processors, PriorityRule rule = PriorityRule::kLongestPath) const;
     static TaskDependencyManager Sample();
 private:
     size_t n_;
     std::vector<std::pair<uint32_t, uint32_t>> edges_;
+    std::vector<uint32_t> durations_;
 };
 
+// Edges point from a package to the packages that need it installed first, i.e. {dep, pkg}.
 class PackageResolver {
 public:
     PackageResolver(size_t pkg_count, const std::vector<std::pair<uint32_t, uint32_t>> &edges);
     DemoResult run(const std::string &algo);
+    // Dependency edges with every edge implied by a longer chain dropped, e.g. for a lock file (empty on a cycle);
+    // see transitive_reduction for the counts reported.
+    ReductionResult reduce(std::vector<std::pair<uint32_t, uint32_t>> &edges) const;
+    // Whether pkg needs dep, directly or transitively. The index is built on the first query.
+    bool depends_on(uint32_t pkg, uint32_t dep);
     static PackageResolver Sample();
 private:
     size_t n_;
     std::vector<std::pair<uint32_t, uint32_t>> edges_;
+    std::shared_ptr<const ReachabilityIndex> reach_;
 };
 
 class SocialHierarchyAnalysis {
@@ -0,0 +1,581 @@
+#include "external_sort.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <sstream>
+#include <tuple>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+namespace {
+using node_t = GraphInterface::node_t;
+using Edge = std::pair<node_t, node_t>;
+using FilePtr = ExternalTopoSorter::FilePtr;
+
+// Unit of input reads, temp-file writes and spilled frontier blocks; budgets under 4 * kIoBlock shrink it (io_block_of)
+// so every buffer still fits, which also lets small budgets exercise multi-pass merges and queue spills.
+constexpr size_t kIoBlock = size_t(1) << 20;
+constexpr size_t kMinMemory = size_t(256) << 10;
+// Smallest buffer a merge reader gets; this bounds the fan-in of one merge pass.
+constexpr size_t kMinReaderBytes = size_t(64) << 10;
+constexpr size_t kMinRunEdges = size_t(1) << 12;
+// Row cache page.
+constexpr size_t kPageBytes = size_t(64) << 10;
+constexpr uint64_t kNoPage = UINT64_MAX;
+constexpr uint64_t kTooBig = uint64_t(1) << 40;
+
+const char *const kTempReadError = "read error on temp file";
+const char *const kTempWriteError = "write error on temp file (disk full?)";
+
+size_t memory_of(const ExternalSortOptions &opt) { return std::max(opt.memory_bytes, kMinMemory); }
+size_t io_block_of(size_t memory) { return std::min(kIoBlock, memory / 4); }
+
+std::string temp_dir_of(const ExternalSortOptions &opt) {
+    if (!opt.temp_dir.empty()) return opt.temp_dir;
+    const char *env = std::getenv("TMPDIR");
+    return env && *env ? env : "/tmp";
+}
+
+FilePtr open_temp(const std::string &dir, std::string &err) {
+#if !defined(_WIN32)
+    std::string path = dir + "/topsort-XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        err = "cannot create temp file in " + dir;
+        return nullptr;
+    }
+    unlink(path.c_str()); // the space is released when the handle closes
+    FilePtr f(fdopen(fd, "w+b"));
+    if (!f) {
+        close(fd);
+        err = "cannot create temp file in " + dir;
+    }
+    return f;
+#else
+    (void)dir;
+    FilePtr f(std::tmpfile());
+    if (!f) err = "cannot create temp file";
+    return f;
+#endif
+}
+
+bool seek(std::FILE *f, uint64_t pos) {
+#if !defined(_WIN32)
+    return fseeko(f, static_cast<off_t>(pos), SEEK_SET) == 0;
+#else
+    return _fseeki64(f, static_cast<__int64>(pos), SEEK_SET) == 0;
+#endif
+}
+
+// Appends varints at a file position through a block-sized buffer. Every flush seeks first, so reads of the same file
+// may be interleaved.
+class VarintWriter {
+public:
+    VarintWriter(std::FILE *f, uint64_t pos, uint64_t &spilled, size_t block)
+        : f_(f), pos_(pos), spilled_(spilled), block_(block) {
+        buf_.reserve(block_ + 8);
+    }
+    void put(uint32_t v) {
+        encode_varint32(v, buf_);
+        if (buf_.size() >= block_) flush();
+    }
+    bool flush() {
+        if (buf_.empty()) return ok_;
+        ok_ = ok_ && seek(f_, pos_) && std::fwrite(buf_.data(), 1, buf_.size(), f_) == buf_.size();
+        pos_ += buf_.size();
+        spilled_ += buf_.size();
+        buf_.clear();
+        return ok_;
+    }
+    uint64_t position() const { return pos_ + buf_.size(); }
+
+private:
+    std::FILE *f_;
+    uint64_t pos_;
+    uint64_t &spilled_;
+    size_t block_;
+    std::vector<uint8_t> buf_;
+    bool ok_{true};
+};
+
+// Reads the varints of [begin, end) of a file through a private buffer, so several readers can share one file.
+class VarintReader {
+public:
+    VarintReader(std::FILE *f, uint64_t begin, uint64_t end, size_t buffer_bytes)
+        : f_(f), pos_(begin), end_(end), buf_(std::max<size_t>(buffer_bytes, 16)) {}
+    // False at the end of the range or on a read error (see ok()).
+    bool next(uint32_t &v) {
+        if (static_cast<size_t>(stop_ - ptr_) < 5 && pos_ < end_ && !refill()) return false;
+        if (ptr_ == stop_) return false;
+        v = decode_varint32(ptr_, stop_);
+        return true;
+    }
+    bool ok() const { return ok_; }
+
+private:
+    bool refill() {
+        size_t keep = static_cast<size_t>(stop_ - ptr_);
+        if (keep != 0) std::memmove(buf_.data(), ptr_, keep);
+        size_t want = static_cast<size_t>(std::min<uint64_t>(buf_.size() - keep, end_ - pos_));
+        ok_ = seek(f_, pos_) && std::fread(buf_.data() + keep, 1, want, f_) == want;
+        pos_ += want;
+        ptr_ = buf_.data();
+        stop_ = buf_.data() + keep + (ok_ ? want : 0);
+        return ok_;
+    }
+
+    std::FILE *f_;
+    uint64_t pos_;
+    uint64_t end_;
+    std::vector<uint8_t> buf_;
+    const uint8_t *ptr_{nullptr};
+    const uint8_t *stop_{nullptr};
+    bool ok_{true};
+};
+
+// A sorted run is a byte range of a temp file. Each edge is two varints: the source minus the previous source, then
+// the target minus the previous target when the source repeats, else the target itself.
+struct Run {
+    uint64_t begin;
+    uint64_t end;
+};
+
+class RunWriter {
+public:
+    explicit RunWriter(VarintWriter &w) : w_(w) {}
+    void put(Edge e) {
+        w_.put(e.first - u_);
+        w_.put(e.first == u_ ? e.second - v_ : e.second);
+        u_ = e.first;
+        v_ = e.second;
+    }
+
+private:
+    VarintWriter &w_;
+    node_t u_{0};
+    node_t v_{0};
+};
+
+class RunReader {
+public:
+    RunReader(std::FILE *f, Run r, size_t buffer_bytes)
+        : in_(f, r.begin, r.end, static_cast<size_t>(std::min<uint64_t>(buffer_bytes, r.end - r.begin + 16))) {}
+    bool next(Edge &e) {
+        uint32_t du, dv;
+        if (!in_.next(du) || !in_.next(dv)) return false;
+        u_ += du;
+        v_ = du == 0 ? v_ + dv : dv;
+        e = {u_, v_};
+        return true;
+    }
+    bool ok() const { return in_.ok(); }
+
+private:
+    VarintReader in_;
+    node_t u_{0};
+    node_t v_{0};
+};
+
+// K-way merge of runs into emit(edge), dropping duplicates across runs. Returns false on a read error.
+template <class Emit>
+bool merge_runs(std::FILE *f, const Run *runs, size_t count, size_t memory_bytes, Emit &&emit) {
+    size_t reader_bytes = std::max(kMinReaderBytes, memory_bytes / (count + 1));
+    std::vector<RunReader> readers;
+    readers.reserve(count);
+    using Item = std::pair<Edge, size_t>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+    for (size_t i = 0; i < count; ++i) {
+        readers.emplace_back(f, runs[i], reader_bytes);
+        Edge e;
+        if (readers[i].next(e)) heap.push({e, i});
+    }
+    bool any = false;
+    Edge last{};
+    while (!heap.empty()) {
+        Item top = heap.top();
+        heap.pop();
+        if (!any || top.first != last) emit(top.first);
+        any = true;
+        last = top.first;
+        Edge e;
+        if (readers[top.second].next(e)) heap.push({e, top.second});
+    }
+    for (const auto &r : readers) {
+        if (!r.ok()) return false;
+    }
+    return true;
+}
+
+// FIFO of node ids whose middle spills to a temp file in blocks of block_ ids: pop order is head_, then the file, then
+// tail_. Only two blocks stay resident.
+class SpillQueue {
+public:
+    SpillQueue(std::FILE *f, uint64_t &spilled, size_t block_bytes)
+        : f_(f), spilled_(spilled), block_(block_bytes / sizeof(node_t)) {
+        tail_.reserve(block_);
+    }
+    void push(node_t v) {
+        tail_.push_back(v);
+        if (tail_.size() == block_) spill();
+    }
+    bool pop(node_t &v) {
+        if (head_pos_ == head_.size() && !refill()) return false;
+        v = head_[head_pos_++];
+        return true;
+    }
+    bool ok() const { return ok_; }
+
+private:
+    void spill() {
+        ok_ = ok_ && seek(f_, written_ * sizeof(node_t)) &&
+              std::fwrite(tail_.data(), sizeof(node_t), tail_.size(), f_) == tail_.size();
+        written_ += tail_.size();
+        spilled_ += tail_.size() * sizeof(node_t);
+        tail_.clear();
+    }
+    bool refill() {
+        head_.clear();
+        head_pos_ = 0;
+        if (read_ < written_) {
+            size_t count = static_cast<size_t>(std::min<uint64_t>(block_, written_ - read_));
+            head_.resize(count);
+            ok_ = ok_ && seek(f_, read_ * sizeof(node_t)) && std::fread(head_.data(), sizeof(node_t), count, f_) == count;
+            read_ += count;
+            if (read_ == written_) read_ = written_ = 0; // drained: reuse the file from the start
+            return ok_;
+        }
+        if (tail_.empty()) return false;
+        head_.swap(tail_);
+        return true;
+    }
+
+    std::FILE *f_;
+    uint64_t &spilled_;
+    size_t block_;
+    std::vector<node_t> head_;
+    size_t head_pos_{0};
+    std::vector<node_t> tail_;
+    uint64_t written_{0};
+    uint64_t read_{0};
+    bool ok_{true};
+};
+
+// Direct-mapped cache of kPageBytes pages of the adjacency file.
+class RowCache {
+public:
+    RowCache(std::FILE *f, uint64_t file_bytes, size_t slots)
+        : f_(f), file_bytes_(file_bytes), pages_(slots * kPageBytes), tags_(slots, kNoPage) {}
+    // Copies bytes [begin, end) into out followed by kVarintPadding zero bytes, as for_each_varint_row expects.
+    bool read(uint64_t begin, uint64_t end, std::vector<uint8_t> &out) {
+        out.assign(static_cast<size_t>(end - begin) + kVarintPadding, 0);
+        uint8_t *dst = out.data();
+        for (uint64_t pos = begin; pos < end;) {
+            uint64_t page = pos / kPageBytes;
+            size_t slot = static_cast<size_t>(page % tags_.size());
+            uint8_t *data = pages_.data() + slot * kPageBytes;
+            if (tags_[slot] != page) {
+                size_t want = static_cast<size_t>(std::min<uint64_t>(kPageBytes, file_bytes_ - page * kPageBytes));
+                if (!seek(f_, page * kPageBytes) || std::fread(data, 1, want, f_) != want) return false;
+                tags_[slot] = page;
+            }
+            size_t at = static_cast<size_t>(pos - page * kPageBytes);
+            size_t take = static_cast<size_t>(std::min<uint64_t>(kPageBytes - at, end - pos));
+            std::memcpy(dst, data + at, take);
+            dst += take;
+            pos += take;
+        }
+        return true;
+    }
+
+private:
+    std::FILE *f_;
+    uint64_t file_bytes_;
+    std::vector<uint8_t> pages_;
+    std::vector<uint64_t> tags_;
+};
+
+bool is_space(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f'; }
+
+// Streams the tokens of the input to on_token(index, value) in reads of `block` bytes. Values above kTooBig saturate.
+// Returns false with err on a read error or a byte that is neither a digit nor whitespace.
+template <class OnToken>
+bool scan_tokens(std::FILE *in, size_t block, std::string &err, OnToken &&on_token) {
+    std::vector<char> buf(block);
+    uint64_t value = 0;
+    bool in_token = false;
+    size_t index = 0;
+    uint64_t offset = 0;
+    for (;;) {
+        size_t got = std::fread(buf.data(), 1, buf.size(), in);
+        for (size_t i = 0; i < got; ++i) {
+            char c = buf[i];
+            if (static_cast<unsigned>(c - '0') <= 9) {
+                value = std::min(value * 10 + static_cast<uint64_t>(c - '0'), kTooBig);
+                in_token = true;
+            } else if (is_space(c)) {
+                if (in_token && !on_token(index++, value)) return false;
+                value = 0;
+                in_token = false;
+            } else if (index < 2) {
+                err = c == '-' && !in_token ? "n and m must be non-negative" : "failed to read n m";
+                return false;
+            } else {
+                std::stringstream ss;
+                ss << "unexpected character at byte " << (offset + i);
+                err = ss.str();
+                return false;
+            }
+        }
+        offset += got;
+        if (got < buf.size()) break;
+    }
+    if (std::ferror(in)) {
+        err = "read error";
+        return false;
+    }
+    return !in_token || on_token(index, value);
+}
+
+void append_uint(std::vector<char> &out, uint32_t v) {
+    char tmp[10];
+    size_t len = 0;
+    do {
+        tmp[len++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    while (len > 0) out.push_back(tmp[--len]);
+}
+} // namespace
+
+ExternalTopoSorter::ExternalTopoSorter(ExternalSortOptions opt) : opt_(std::move(opt)) {}
+
+ExternalTopoSorter::~ExternalTopoSorter() = default;
+
+bool ExternalTopoSorter::load_edge_list(const std::string &path, std::string &err) {
+    FilePtr in(std::fopen(path.c_str(), "rb"));
+    if (!in) {
+        err = "cannot open " + path;
+        return false;
+    }
+    return load_edge_list(in.get(), err);
+}
+
+bool ExternalTopoSorter::load_edge_list(std::FILE *in, std::string &err) {
+    stats_ = ExternalSortStats{};
+    adjacency_.reset();
+    row_offsets_.clear();
+    indeg_.clear();
+    const std::string dir = temp_dir_of(opt_);
+    const size_t memory = memory_of(opt_);
+    const size_t block = io_block_of(memory);
+
+    // Phase 1: sorted, deduplicated runs.
+    FilePtr runs_file = open_temp(dir, err);
+    if (!runs_file) return false;
+    VarintWriter out(runs_file.get(), 0, stats_.spilled_bytes, block);
+    std::vector<Run> runs;
+    std::vector<Edge> buffer;
+    const size_t run_edges = std::max(kMinRunEdges, (memory - 2 * block) / sizeof(Edge));
+    auto spill = [&] {
+        std::sort(buffer.begin(), buffer.end());
+        buffer.erase(std::unique(buffer.begin(), buffer.end()), buffer.end());
+        Run r{out.position(), 0};
+        RunWriter w(out);
+        for (const Edge &e : buffer) w.put(e);
+        r.end = out.position();
+        runs.push_back(r);
+        buffer.clear();
+    };
+
+    uint64_t n = 0, m = 0;
+    size_t tokens = 0;
+    node_t pending = 0;
+    bool bad_endpoint = false;
+    bool ok = scan_tokens(in, block, err, [&](size_t index, uint64_t value) {
+        tokens = index + 1;
+        if (index < 2) {
+            if (value > INT32_MAX) {
+                err = "failed to read n m";
+                return false;
+            }
+            (index == 0 ? n : m) = value;
+            if (index == 1) buffer.reserve(static_cast<size_t>(std::min<uint64_t>(run_edges, m)));
+            return true;
+        }
+        if (index - 2 >= 2 * m) {
+            err = "unrecognized input format";
+            return false;
+        }
+        if (value >= n) bad_endpoint = true;
+        if ((index & 1) == 0) {
+            pending = static_cast<node_t>(value);
+            return true;
+        }
+        buffer.emplace_back(pending, static_cast<node_t>(value));
+        if (buffer.size() == run_edges) spill();
+        return true;
+    });
+    if (!ok) return false;
+    if (tokens < 2) {
+        err = "failed to read n m";
+        return false;
+    }
+    // Same precedence as parse_graph_text: the token count decides the format before endpoints are checked.
+    if (tokens != 2 + 2 * m) {
+        err = "unrecognized input format";
+        return false;
+    }
+    if (!buffer.empty()) spill();
+    if (!out.flush()) {
+        err = kTempWriteError;
+        return false;
+    }
+    if (bad_endpoint) {
+        err = "edge endpoint out of range";
+        return false;
+    }
+    stats_.node_count = static_cast<size_t>(n);
+    stats_.input_edges = static_cast<size_t>(m);
+    stats_.runs = runs.size();
+
+    // Intermediate passes until one merge can take every run.
+    const size_t fan_in = std::max<size_t>(2, memory / kMinReaderBytes - 1);
+    while (runs.size() > fan_in) {
+        FilePtr next_file = open_temp(dir, err);
+        if (!next_file) return false;
+        VarintWriter next_out(next_file.get(), 0, stats_.spilled_bytes, block);
+        std::vector<Run> merged;
+        for (size_t g = 0; g < runs.size(); g += fan_in) {
+            size_t count = std::min(fan_in, runs.size() - g);
+            Run r{next_out.position(), 0};
+            RunWriter w(next_out);
+            if (!merge_runs(runs_file.get(), runs.data() + g, count, memory, [&](Edge e) { w.put(e); })) {
+                err = kTempReadError;
+                return false;
+            }
+            r.end = next_out.position();
+            merged.push_back(r);
+        }
+        if (!next_out.flush()) {
+            err = kTempWriteError;
+            return false;
+        }
+        runs_file = std::move(next_file);
+        runs = std::move(merged);
+        ++stats_.merge_passes;
+    }
+
+    // Phase 2: final merge into varint rows plus row offsets and indegrees.
+    FilePtr adjacency = open_temp(dir, err);
+    if (!adjacency) return false;
+    VarintWriter rows(adjacency.get(), 0, stats_.spilled_bytes, block);
+    row_offsets_.assign(static_cast<size_t>(n) + 1, 0);
+    indeg_.assign(static_cast<size_t>(n), 0);
+    size_t filled = 0; // row_offsets_[0 .. filled] are final
+    node_t src = 0, prev = 0;
+    bool merged_ok = merge_runs(runs_file.get(), runs.data(), runs.size(), memory, [&](Edge e) {
+        bool first = stats_.edge_count == 0 || e.first != src;
+        while (filled < e.first) row_offsets_[++filled] = rows.position();
+        rows.put(first ? e.second : e.second - prev);
+        src = e.first;
+        prev = e.second;
+        indeg_[e.second]++;
+        stats_.edge_count++;
+    });
+    if (!merged_ok) {
+        err = kTempReadError;
+        return false;
+    }
+    while (filled < n) row_offsets_[++filled] = rows.position();
+    if (!rows.flush()) {
+        err = kTempWriteError;
+        return false;
+    }
+    ++stats_.merge_passes;
+    stats_.adjacency_bytes = rows.position();
+    adjacency_ = std::move(adjacency);
+    return true;
+}
+
+template <class Emit>
+bool ExternalTopoSorter::kahn(Emit &&emit, bool &has_cycle, std::string &err) {
+    has_cycle = false;
+    const size_t n = stats_.node_count;
+    if (!adjacency_ && n != 0) {
+        err = "no graph loaded";
+        return false;
+    }
+    FilePtr queue_file = open_temp(temp_dir_of(opt_), err);
+    if (!queue_file) return false;
+    std::vector<uint32_t> indeg = indeg_;
+    const size_t memory = memory_of(opt_);
+    const size_t block = io_block_of(memory);
+    SpillQueue queue(queue_file.get(), stats_.spilled_bytes, block);
+    RowCache cache(adjacency_.get(), stats_.adjacency_bytes, (memory - 2 * block) / kPageBytes);
+
+    for (node_t u = 0; u < n; ++u) {
+        if (indeg[u] == 0) queue.push(u);
+    }
+    std::vector<uint8_t> row;
+    size_t emitted = 0;
+    node_t u;
+    while (queue.pop(u)) {
+        emit(u);
+        ++emitted;
+        if (!cache.read(row_offsets_[u], row_offsets_[u + 1], row)) {
+            err = kTempReadError;
+            return false;
+        }
+        const uint8_t *begin = row.data();
+        const uint8_t *end = begin + (row.size() - kVarintPadding);
+        for_each_varint_row(begin, end, begin + row.size(), [&](node_t v) {
+            if (--indeg[v] == 0) queue.push(v);
+        });
+    }
+    if (!queue.ok()) {
+        err = kTempWriteError;
+        return false;
+    }
+    has_cycle = emitted != n;
+    return true;
+}
+
+bool ExternalTopoSorter::run(std::vector<node_t> &order, bool &has_cycle, std::string &err) {
+    order.clear();
+    order.reserve(stats_.node_count);
+    return kahn([&](node_t u) { order.push_back(u); }, has_cycle, err);
+}
+
+bool ExternalTopoSorter::run_to_file(const std::string &path, bool &has_cycle, std::string &err) {
+    FilePtr out(std::fopen(path.c_str(), "wb"));
+    if (!out) {
+        err = "cannot open " + path + " for writing";
+        return false;
+    }
+    std::vector<char> buf;
+    const size_t block = io_block_of(memory_of(opt_));
+    buf.reserve(block + 16);
+    bool write_ok = true;
+    auto drain = [&] {
+        write_ok = write_ok && std::fwrite(buf.data(), 1, buf.size(), out.get()) == buf.size();
+        buf.clear();
+    };
+    bool ok = kahn(
+        [&](node_t u) {
+            append_uint(buf, u);
+            buf.push_back('\n');
+            if (buf.size() >= block) drain();
+        },
+        has_cycle, err);
+    drain();
+    if (ok && (!write_ok || std::fflush(out.get()) != 0)) {
+        err = "write failed for " + path;
+        return false;
+    }
+    return ok;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "compressed_graph.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// External-memory Kahn for edge lists larger than RAM. Only O(n) state stays resident (indegrees and one 64-bit row
+// offset per node, 12 bytes a node); the edges live in temp files:
+//   1. The edge list ("n m" then m pairs "u v", same errors as parse_graph_text) is read in fixed-size chunks into a
+//      run buffer; each full buffer is sorted, deduplicated and spilled as a varint-coded sorted run.
+//   2. Runs are k-way merged (in several passes when there are more than the buffers allow) into one adjacency file
+//      of delta-coded varint rows, the layout of CompressedGraph::build_varint, counting indegrees on the way.
+//   3. Kahn pops a FIFO frontier that spills to disk in blocks and reads rows through a page cache.
+// Rows end up sorted and deduplicated and the frontier is FIFO, so the order equals KahnTopoSolver on the same graph.
+// memory_bytes caps the buffers (run buffer, merge readers, row cache, frontier blocks), not the O(n) arrays. It is
+// raised to at least 256 KiB; below 4 MiB the 1 MiB I/O and frontier blocks shrink to a quarter of the budget.
+struct ExternalSortOptions {
+    size_t memory_bytes{size_t(64) << 20};
+    std::string temp_dir; // empty: $TMPDIR, else /tmp (Windows: the CRT temp directory)
+};
+
+struct ExternalSortStats {
+    size_t node_count{0};
+    size_t input_edges{0};
+    size_t edge_count{0}; // after deduplication
+    size_t runs{0};
+    size_t merge_passes{0};
+    uint64_t adjacency_bytes{0}; // varint rows
+    uint64_t spilled_bytes{0};   // everything written to temp files
+};
+
+class ExternalTopoSorter {
+public:
+    using node_t = GraphInterface::node_t;
+    struct FileCloser {
+        void operator()(std::FILE *f) const { if (f) std::fclose(f); }
+    };
+    using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+
+    explicit ExternalTopoSorter(ExternalSortOptions opt = {});
+    ~ExternalTopoSorter();
+    ExternalTopoSorter(const ExternalTopoSorter &) = delete;
+    ExternalTopoSorter &operator=(const ExternalTopoSorter &) = delete;
+
+    // Phases 1 and 2. Temp files are unlinked as soon as they are created, so nothing is left behind on exit.
+    bool load_edge_list(const std::string &path, std::string &err);
+    bool load_edge_list(std::FILE *f, std::string &err);
+
+    // Phase 3; may run any number of times after a load. has_cycle is set when not every node could be ordered (the
+    // order then holds the nodes before the stall). run_to_file writes one id per line.
+    bool run(std::vector<node_t> &order, bool &has_cycle, std::string &err);
+    bool run_to_file(const std::string &path, bool &has_cycle, std::string &err);
+
+    const ExternalSortStats &stats() const { return stats_; }
+
+private:
+    template <class Emit>
+    bool kahn(Emit &&emit, bool &has_cycle, std::string &err);
+
+    ExternalSortOptions opt_;
+    ExternalSortStats stats_;
+    FilePtr adjacency_;
+    std::vector<uint64_t> row_offsets_; // n+1 byte offsets into adjacency_
+    std::vector<uint32_t> indeg_;
+};
@@ -1,7 +1,7 @@
 #include "graph_clean.hpp"
+#include "output_writer.hpp"
 
 #include <algorithm>
-#include <functional>
 #include <deque>
 #include <sstream>
 #include <vector>
@@ -23,19 +23,29 @@ std::pair<int,int> get_neighbors(int u, const std::vector<int> &h) {
 
 bool topsort_dfs(int n, const std::vector<int> &h, const std::vector<int> &list, std::vector<int> &topo) {
     std::vector<int> state(n, 0); // 0 unvisited,1 visiting,2 done
+    std::vector<std::pair<int,int>> stack; // (node, next edge index); explicit to survive deep chains
     topo.clear(); topo.reserve(n);
-    std::function<bool(int)> dfs = [&](int u)->bool{
-        state[u] = 1;
-        for (int idx = h[u]; idx < h[u+1]; ++idx) {
-            int v = list[idx];
+    for (int i = 0; i < n; ++i) {
+        if (state[i] != 0) continue;
+        state[i] = 1;
+        stack.push_back({i, h[i]});
+        while (!stack.empty()) {
+            auto &top = stack.back();
+            int u = top.first;
+            if (top.second == h[u+1]) {
+                state[u] = 2;
+                topo.push_back(u);
+                stack.pop_back();
+                continue;
+            }
+            int v = list[top.second++];
             if (state[v] == 1) return true; // found cycle
-            if (state[v] == 0) if (dfs(v)) return true;
+            if (state[v] == 0) {
+                state[v] = 1;
+                stack.push_back({v, h[v]});
+            }
         }
-        state[u] = 2;
-        topo.push_back(u);
-        return false;
-    };
-    for (int i = 0; i < n; ++i) if (state[i] == 0) if (dfs(i)) return true;
+    }
     std::reverse(topo.begin(), topo.end());
     return false;
 }
@@ -58,11 +68,10 @@ bool topsort_kahn(int n, const std::vector<int> &h, const std::vector<int> &list
 }
 
 std::string to_json_array(const std::vector<int> &a) {
-    std::string s = "[";
-    for (size_t i = 0; i < a.size(); ++i) {
-        if (i) s += ",";
-        s += std::to_string(a[i]);
-    }
-    s += "]";
+    std::string s;
+    s.reserve(a.size() * 8 + 2);
+    OutputWriter w(s);
+    write_json_array(w, a);
+    w.flush();
     return s;
 }
@@ -1,46 +1,56 @@
 #pragma once
 
+#include "csr_builder.hpp"
+
 #include <cstdint>
+#include <cstdio>
 #include <string>
 #include <utility>
 #include <vector>
 
-// GraphDataStore keeps both adjacency lists and CSR (offsets/neighbors) in sync.
-// All node ids are 0..n-1.
+// GraphDataStore holds a CSR (offsets/neighbors) built directly by csr_builder; the adjacency-list view is derived
+// from it on first request. All node ids are 0..n-1.
 struct ValidationResult {
     bool ok{false};
     bool has_cycle{false};
     std::string error; // empty when ok==true
+    std::vector<uint32_t> cycle; // when has_cycle: a shortest cycle through its smallest node (see find_cycle)
 };
 
 class GraphDataStore {
 public:
     using node_t = uint32_t;
 
-    // Load from an adjacency list; deduplicates neighbors and rebuilds CSR.
+    // Load from an adjacency list; deduplicates neighbors and builds the CSR.
     bool load_from_adj(const std::vector<std::vector<node_t>> &adj, std::string &err);
 
     // Parse from text. Supported formats:
     // 1) Edge list: first line n m; then m pairs u v.
     // 2) Compressed CSR: first line n m; then h[0..n] followed by list, where h[n] == list.size().
+    // Parsing is zero-copy and chunk-parallel (see text_parser.hpp).
     bool load_from_text(const std::string &text, std::string &err);
+    bool load_from_buffer(const char *data, size_t size, std::string &err);
+    // Memory-maps the file where supported.
+    bool load_from_file(const std::string &path, std::string &err);
+    // Reads stdin (or any FILE*) in fixed-size chunks.
+    bool load_from_stream(std::FILE *f, std::string &err);
 
     // Validate internal consistency and check DAG (cycle-free). Returns false on any error.
     bool validate_graph(ValidationResult &out) const;
 
     // Accessors
-    size_t node_count() const { return adj_.size(); }
-    const std::vector<std::vector<node_t>> &adjacency() const { return adj_; }
-    const std::vector<node_t> &offsets() const { return offsets_; }
-    const std::vector<node_t> &neighbors() const { return neighbors_; }
+    size_t node_count() const { return csr_.offsets.empty() ? 0 : csr_.offsets.size() - 1; }
+    // Materialized from the CSR on first call and cached; not safe to call concurrently.
+    const std::vector<std::vector<node_t>> &adjacency() const;
+    const std::vector<node_t> &offsets() const { return csr_.offsets; }
+    const std::vector<node_t> &neighbors() const { return csr_.neighbors; }
 
 private:
-    void rebuild_csr();
-    bool parse_rest(int n, int m, const std::vector<int> &rest, std::string &err);
-    static void sort_and_dedup(std::vector<node_t> &v);
+    void set_csr(CsrData &&csr);
+    bool finish_load(std::string &err);
     bool detect_cycle() const;
 
-    std::vector<std::vector<node_t>> adj_{};
-    std::vector<node_t> offsets_{};  // size n+1
-    std::vector<node_t> neighbors_{};
+    CsrData csr_{};                                   // offsets size n+1
+    mutable std::vector<std::vector<node_t>> adj_{};  // lazily derived from csr_
+    mutable bool adj_valid_{false};
 };
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Fast non-cryptographic streaming 64-bit hash, consumed 8 bytes at a time (multiply/rotate mixing with a final
+// avalanche). Used for file checksums; not suitable against adversarial input. Feeding the same bytes in any split
+// across update() calls gives the same result.
+class Hash64 {
+public:
+    explicit Hash64(uint64_t seed = 0x9E3779B97F4A7C15ull) : h_(seed) {}
+
+    Hash64 &update(const void *data, size_t len) {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        total_ += len;
+        if (pending_ != 0) {
+            while (len != 0 && pending_ < 8) {
+                tail_[pending_++] = *p++;
+                --len;
+            }
+            if (pending_ < 8) return *this;
+            mix_word(tail_);
+            pending_ = 0;
+        }
+        for (; len >= 8; len -= 8, p += 8) mix_word(p);
+        if (len != 0) std::memcpy(tail_, p, len);
+        pending_ = len;
+        return *this;
+    }
+
+    uint64_t finish() const {
+        uint64_t h = h_ ^ (total_ * kMul1);
+        if (pending_ != 0) {
+            uint64_t tail = 0;
+            std::memcpy(&tail, tail_, pending_);
+            h ^= tail * kMul1;
+        }
+        h ^= h >> 33;
+        h *= kMul1;
+        h ^= h >> 33;
+        h *= kMul2;
+        h ^= h >> 33;
+        return h;
+    }
+
+private:
+    static constexpr uint64_t kMul1 = 0xFF51AFD7ED558CCDull;
+    static constexpr uint64_t kMul2 = 0xC4CEB9FE1A85EC53ull;
+
+    void mix_word(const unsigned char *p) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        h_ ^= w * kMul1;
+        h_ = (h_ << 31) | (h_ >> 33);
+        h_ *= kMul2;
+    }
+
+    uint64_t h_;
+    uint64_t total_{0};
+    unsigned char tail_[8]{};
+    size_t pending_{0};
+};
+
+inline uint64_t hash_bytes64(const void *data, size_t len) { return Hash64().update(data, len).finish(); }
+
+// splitmix64 finalizer: a bijective 64-bit mix.
+inline uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Structural graph fingerprint: the node count mixed with the wrapping sum of edge_hash over the edge set. The sum does
+// not depend on row or edge order, so rows can be hashed in parallel and one edge is added or removed in O(1).
+inline uint64_t edge_hash(uint32_t u, uint32_t v) { return mix64((uint64_t(u) << 32) | v); }
+inline uint64_t graph_fingerprint(size_t n, uint64_t edge_hash_sum) {
+    return mix64(edge_hash_sum ^ mix64(static_cast<uint64_t>(n) ^ 0x5851F42D4C957F2Dull));
+}
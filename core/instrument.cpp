@@ -0,0 +1,225 @@
+#include "instrument.hpp"
+
+#include <cstdio>
+#include <string>
+
+#if !defined(TOPSORT_NO_INSTRUMENT) && !defined(TOPSORT_NO_THREADS)
+#include <mutex>
+#endif
+
+namespace instr {
+
+namespace {
+const char *const kCounterNames[] = {
+    "edges_scanned", "levels", "max_frontier", "csr_rebuilds", "varint_builds",
+    "relabels", "relabel_nodes", "max_relabel", "spin_contended",
+};
+static_assert(sizeof(kCounterNames) / sizeof(kCounterNames[0]) == static_cast<size_t>(Counter::kCount),
+              "one name per counter");
+
+void append_uint(std::string &out, uint64_t v) {
+    char buf[24];
+    int len = std::snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(v));
+    out.append(buf, static_cast<size_t>(len));
+}
+
+void append_ms(std::string &out, uint64_t ns) {
+    char buf[32];
+    int len = std::snprintf(buf, sizeof(buf), "%.3f", static_cast<double>(ns) / 1e6);
+    out.append(buf, static_cast<size_t>(len));
+}
+
+#ifndef TOPSORT_NO_INSTRUMENT
+struct TraceEvent {
+    const char *name;
+    uint64_t start_ns; // since the trace epoch
+    uint64_t dur_ns;
+    uint32_t tid;
+};
+
+#ifndef TOPSORT_NO_THREADS
+using Mutex = std::mutex;
+using Guard = std::lock_guard<std::mutex>;
+#else
+struct Mutex {};
+struct Guard {
+    explicit Guard(Mutex &) {}
+};
+#endif
+
+// Everything a phase or level touches; the counters live outside so the inline hooks reach them without a call.
+struct State {
+    Mutex mu;
+    std::vector<PhaseTotal> phases; // few distinct names, so a linear scan by pointer beats a map
+    std::vector<uint32_t> widths;
+    std::atomic<size_t> widths_size{0}; // widths.size(), readable without the mutex
+    bool tracing{false};
+    std::chrono::steady_clock::time_point epoch{std::chrono::steady_clock::now()};
+    std::vector<TraceEvent> events;
+};
+
+State &state() {
+    static State s;
+    return s;
+}
+
+uint32_t thread_index() {
+    static std::atomic<uint32_t> next{1};
+    thread_local uint32_t id = next.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+uint64_t ns_between(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+    if (b <= a) return 0;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count());
+}
+#endif
+} // namespace
+
+const char *counter_name(Counter c) {
+    size_t i = static_cast<size_t>(c);
+    return i < static_cast<size_t>(Counter::kCount) ? kCounterNames[i] : "unknown";
+}
+
+#ifndef TOPSORT_NO_INSTRUMENT
+
+namespace detail {
+std::atomic<bool> g_enabled{false};
+std::atomic<uint64_t> g_counters[static_cast<size_t>(Counter::kCount)]{};
+
+void record_phase(const char *name, std::chrono::steady_clock::time_point start,
+                  std::chrono::steady_clock::time_point end) {
+    State &s = state();
+    uint64_t ns = ns_between(start, end);
+    Guard lock(s.mu);
+    PhaseTotal *slot = nullptr;
+    for (auto &p : s.phases) {
+        if (p.name == name) {
+            slot = &p;
+            break;
+        }
+    }
+    if (!slot) {
+        s.phases.push_back({name, 0, 0});
+        slot = &s.phases.back();
+    }
+    slot->ns += ns;
+    ++slot->calls;
+    if (s.tracing && s.events.size() < kMaxTraceEvents) {
+        s.events.push_back({name, ns_between(s.epoch, start), ns, thread_index()});
+    }
+}
+
+void record_level(uint64_t width) {
+    g_counters[static_cast<size_t>(Counter::kLevels)].fetch_add(1, std::memory_order_relaxed);
+    raise_to(Counter::kMaxFrontier, width);
+    State &s = state();
+    // Once the widths are full, every later level (a long chain has millions) skips the mutex.
+    if (s.widths_size.load(std::memory_order_relaxed) >= kMaxRecordedLevels) return;
+    Guard lock(s.mu);
+    if (s.widths.size() < kMaxRecordedLevels) s.widths.push_back(static_cast<uint32_t>(width));
+    s.widths_size.store(s.widths.size(), std::memory_order_relaxed);
+}
+} // namespace detail
+
+void set_enabled(bool on) { detail::g_enabled.store(on, std::memory_order_relaxed); }
+
+void set_tracing(bool on) {
+    State &s = state();
+    {
+        Guard lock(s.mu);
+        s.tracing = on;
+        if (on) {
+            s.events.clear();
+            s.epoch = std::chrono::steady_clock::now();
+        }
+    }
+    if (on) set_enabled(true);
+}
+
+Snapshot snapshot() {
+    Snapshot snap;
+    for (size_t i = 0; i < static_cast<size_t>(Counter::kCount); ++i) {
+        snap.counters[i] = detail::g_counters[i].load(std::memory_order_relaxed);
+    }
+    State &s = state();
+    Guard lock(s.mu);
+    snap.phases = s.phases;
+    snap.frontier_widths = s.widths;
+    return snap;
+}
+
+void reset() {
+    for (auto &c : detail::g_counters) c.store(0, std::memory_order_relaxed);
+    State &s = state();
+    Guard lock(s.mu);
+    s.phases.clear();
+    s.widths.clear();
+    s.widths_size.store(0, std::memory_order_relaxed);
+}
+
+#endif
+
+std::string to_json(const Snapshot &s) {
+    std::string out = "{\"phases\":{";
+    for (size_t i = 0; i < s.phases.size(); ++i) {
+        if (i) out += ',';
+        out += '"';
+        out += s.phases[i].name; // literals chosen by the code base, nothing to escape
+        out += "\":{\"ms\":";
+        append_ms(out, s.phases[i].ns);
+        out += ",\"calls\":";
+        append_uint(out, s.phases[i].calls);
+        out += '}';
+    }
+    out += "},\"counters\":{";
+    for (size_t i = 0; i < static_cast<size_t>(Counter::kCount); ++i) {
+        if (i) out += ',';
+        out += '"';
+        out += kCounterNames[i];
+        out += "\":";
+        append_uint(out, s.counters[i]);
+    }
+    out += "},\"frontier_widths\":[";
+    for (size_t i = 0; i < s.frontier_widths.size(); ++i) {
+        if (i) out += ',';
+        append_uint(out, s.frontier_widths[i]);
+    }
+    out += "]}";
+    return out;
+}
+
+bool write_chrome_trace(const std::string &path, std::string &err) {
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        err = "cannot open trace file: " + path;
+        return false;
+    }
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+#ifndef TOPSORT_NO_INSTRUMENT
+    {
+        State &s = state();
+        Guard lock(s.mu);
+        char buf[64];
+        for (size_t i = 0; i < s.events.size(); ++i) {
+            const TraceEvent &e = s.events[i];
+            if (i) out += ',';
+            out += "\n{\"name\":\"";
+            out += e.name;
+            out += "\",\"cat\":\"topsort\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+            append_uint(out, e.tid);
+            // Trace timestamps are microseconds; keep the fraction so sub-microsecond phases stay visible.
+            int len = std::snprintf(buf, sizeof(buf), ",\"ts\":%.3f,\"dur\":%.3f}", static_cast<double>(e.start_ns) / 1e3,
+                                    static_cast<double>(e.dur_ns) / 1e3);
+            out.append(buf, static_cast<size_t>(len));
+        }
+    }
+#endif
+    out += "\n]}\n";
+    bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) err = "failed to write trace file: " + path;
+    return ok;
+}
+
+} // namespace instr
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Per-phase timers and hot-path counters for attributing latency (parse, CSR rebuild, varint build, indegrees, solver
+// loops, layout, JSON). Recording is off until instr::set_enabled(true); while off every hook is one relaxed load and
+// a branch, and kernels count edges in a register and publish the total once per run. Define TOPSORT_NO_INSTRUMENT
+// (CMake: -DTOPSORT_INSTRUMENT=OFF) to compile every hook out.
+//
+// Phases are aggregated by name (a string literal) and, with tracing on, also kept as Chrome trace events
+// ("ph":"X", loadable in chrome://tracing or Perfetto). Phases and the first kMaxRecordedLevels level widths take a
+// mutex (later levels only bump counters), so they belong around whole passes and levels, never inside edge loops.
+namespace instr {
+
+enum class Counter : uint8_t {
+    kEdgesScanned,   // edges walked by solver kernels
+    kLevels,         // frontiers processed by level-synchronous solvers
+    kMaxFrontier,    // widest such frontier (a maximum, not a sum)
+    kCsrRebuilds,    // CompressedGraph overlay compactions into a new base
+    kVarintBuilds,   // varint rows (re)encoded
+    kRelabels,       // IncrementalTopoSolver reorders (Pearce-Kelly moves and window re-sorts)
+    kRelabelNodes,   // nodes reassigned by those reorders, summed
+    kMaxRelabel,     // largest single reorder (a maximum)
+    kSpinContended,  // SpinLock acquisitions that found the lock held
+    kCount,
+};
+
+const char *counter_name(Counter c);
+
+struct PhaseTotal {
+    const char *name;
+    uint64_t ns;
+    uint64_t calls;
+};
+
+struct Snapshot {
+    uint64_t counters[static_cast<size_t>(Counter::kCount)]{};
+    std::vector<PhaseTotal> phases;       // in order of first use
+    std::vector<uint32_t> frontier_widths; // first kMaxRecordedLevels level widths since the last reset
+};
+
+// Level widths kept in a snapshot; later levels still count in kLevels / kMaxFrontier.
+constexpr size_t kMaxRecordedLevels = 4096;
+// Trace events buffered before new ones are dropped.
+constexpr size_t kMaxTraceEvents = size_t(1) << 20;
+
+#ifndef TOPSORT_NO_INSTRUMENT
+
+namespace detail {
+extern std::atomic<bool> g_enabled;
+extern std::atomic<uint64_t> g_counters[static_cast<size_t>(Counter::kCount)];
+void record_phase(const char *name, std::chrono::steady_clock::time_point start,
+                  std::chrono::steady_clock::time_point end);
+void record_level(uint64_t width);
+} // namespace detail
+
+inline bool enabled() { return detail::g_enabled.load(std::memory_order_relaxed); }
+void set_enabled(bool on);
+// Start (dropping any buffered events) or stop buffering every phase as a trace event; on implies set_enabled(true).
+void set_tracing(bool on);
+
+inline void add(Counter c, uint64_t v) {
+    if (enabled()) detail::g_counters[static_cast<size_t>(c)].fetch_add(v, std::memory_order_relaxed);
+}
+inline void raise_to(Counter c, uint64_t v) {
+    if (!enabled()) return;
+    auto &slot = detail::g_counters[static_cast<size_t>(c)];
+    uint64_t cur = slot.load(std::memory_order_relaxed);
+    while (cur < v && !slot.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+}
+// One processed frontier of a level-synchronous solver.
+inline void level(uint64_t width) {
+    if (enabled()) detail::record_level(width);
+}
+
+// Times its scope as phase `name` (a string literal: phases are keyed by pointer).
+class ScopedPhase {
+public:
+    explicit ScopedPhase(const char *name) : name_(enabled() ? name : nullptr) {
+        if (name_) start_ = std::chrono::steady_clock::now();
+    }
+    ~ScopedPhase() {
+        if (name_) detail::record_phase(name_, start_, std::chrono::steady_clock::now());
+    }
+    ScopedPhase(const ScopedPhase &) = delete;
+    ScopedPhase &operator=(const ScopedPhase &) = delete;
+
+private:
+    const char *name_;
+    std::chrono::steady_clock::time_point start_{};
+};
+
+Snapshot snapshot();
+void reset(); // counters, phases and level widths; buffered trace events are kept
+
+#define TOPSORT_INSTR_CAT2(a, b) a##b
+#define TOPSORT_INSTR_CAT(a, b) TOPSORT_INSTR_CAT2(a, b)
+#define TOPSORT_PHASE(name) ::instr::ScopedPhase TOPSORT_INSTR_CAT(topsort_phase_, __LINE__)(name)
+#define TOPSORT_COUNT(counter, v) ::instr::add(::instr::Counter::counter, static_cast<uint64_t>(v))
+#define TOPSORT_MAX(counter, v) ::instr::raise_to(::instr::Counter::counter, static_cast<uint64_t>(v))
+#define TOPSORT_LEVEL(width) ::instr::level(static_cast<uint64_t>(width))
+
+#else
+
+inline bool enabled() { return false; }
+inline void set_enabled(bool) {}
+inline void set_tracing(bool) {}
+inline void add(Counter, uint64_t) {}
+inline void raise_to(Counter, uint64_t) {}
+inline void level(uint64_t) {}
+inline Snapshot snapshot() { return Snapshot{}; }
+inline void reset() {}
+
+#define TOPSORT_PHASE(name) ((void)0)
+#define TOPSORT_COUNT(counter, v) ((void)(v))
+#define TOPSORT_MAX(counter, v) ((void)(v))
+#define TOPSORT_LEVEL(width) ((void)(width))
+
+#endif
+
+// {"phases":{"<name>":{"ms":..,"calls":..},..},"counters":{"<name>":..,..},"frontier_widths":[..]}
+std::string to_json(const Snapshot &s);
+// Chrome trace-event JSON of the buffered phases. Returns false with err when the file cannot be written; with
+// instrumentation compiled out the file holds an empty trace.
+bool write_chrome_trace(const std::string &path, std::string &err);
+
+} // namespace instr
@@ -1,19 +1,12 @@
 #include "layout.hpp"
+#include "output_writer.hpp"
+#include "topo_kernels.hpp"
 
 #include <cmath>
-#include <sstream>
 
 std::vector<uint32_t> compute_layers(const GraphInterface &g, const std::vector<uint32_t> &topo) {
-    size_t n = g.node_count();
-    std::vector<uint32_t> layer(n, 0);
-    for (uint32_t u : topo) {
-        auto span = g.neighbor_span(u);
-        for (auto it = span.first; it != span.second; ++it) {
-            uint32_t v = *it;
-            uint32_t cand = layer[u] + 1;
-            if (cand > layer[v]) layer[v] = cand;
-        }
-    }
+    std::vector<uint32_t> layer;
+    visit_graph(g, [&](const auto &cg) { kernels::layers(cg, topo, layer); });
     return layer;
 }
 
@@ -22,6 +15,7 @@ std::vector<LayoutPoint> make_layered_layout(const GraphInterface &g,
                                             float layer_gap,
                                             float radius_base,
                                             float radius_step) {
+    TOPSORT_PHASE("layout");
     size_t n = g.node_count();
     std::vector<uint32_t> layer = compute_layers(g, topo);
     uint32_t max_layer = 0;
@@ -51,17 +45,11 @@ std::vector<LayoutPoint> make_layered_layout(const GraphInterface &g,
 }
 
 std::string layout_to_json(const std::vector<LayoutPoint> &pts) {
-    std::ostringstream oss;
-    oss << '[';
-    for (size_t i = 0; i < pts.size(); ++i) {
-        const auto &p = pts[i];
-        if (i) oss << ',';
-        oss << "{\"id\":" << p.id
-            << ",\"x\":" << p.x
-            << ",\"y\":" << p.y
-            << ",\"z\":" << p.z
-            << ",\"layer\":" << p.layer << '}';
-    }
-    oss << ']';
-    return oss.str();
+    TOPSORT_PHASE("json");
+    std::string s;
+    s.reserve(pts.size() * 64 + 2);
+    OutputWriter w(s);
+    write_layout_json(w, pts);
+    w.flush();
+    return s;
 }
@@ -23,5 +23,6 @@ std::vector<LayoutPoint> make_layered_layout(const GraphInterface &g,
                                             float radius_base = 2.0f,
                                             float radius_step = 1.0f);
 
-// Serialize layout points to JSON: [{"id":0,"x":..,"y":..,"z":..,"layer":0}, ...]
+// Serialize layout points to JSON: [{"id":0,"x":..,"y":..,"z":..,"layer":0}, ...]. Coordinates use the shortest
+// round-trip form. To stream instead of building a string, use write_layout_json or ResultWriter (output_writer.hpp).
 std::string layout_to_json(const std::vector<LayoutPoint> &pts);
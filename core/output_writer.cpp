@@ -0,0 +1,337 @@
+#include "output_writer.hpp"
+#include "layout.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+// Room for any to_chars result of a float or double (and the snprintf fallback), so one reserve() covers it.
+constexpr size_t kMaxNumberChars = 32;
+constexpr uint32_t kEndianTag = 0x01020304u;
+
+static_assert(sizeof(LayoutPoint) == 20, "binary layout points are written as the struct bytes");
+static_assert(sizeof(int) == sizeof(int32_t), "int arrays are written as i32");
+
+void write_layout_point(OutputWriter &w, const LayoutPoint &p) {
+    w.put("{\"id\":");
+    w.put_uint(p.id);
+    w.put(",\"x\":");
+    w.put_float(p.x);
+    w.put(",\"y\":");
+    w.put_float(p.y);
+    w.put(",\"z\":");
+    w.put_float(p.z);
+    w.put(",\"layer\":");
+    w.put_uint(p.layer);
+    w.put('}');
+}
+} // namespace
+
+OutputWriter::OutputWriter(std::FILE *f, size_t buffer)
+    : sink_(Sink::kFile), file_(f), buf_(std::max(buffer, kMaxNumberChars)), pos_(buf_.data()),
+      end_(buf_.data() + buf_.size()) {}
+
+OutputWriter::OutputWriter(int fd, size_t buffer)
+    : sink_(Sink::kFd), fd_(fd), buf_(std::max(buffer, kMaxNumberChars)), pos_(buf_.data()),
+      end_(buf_.data() + buf_.size()) {}
+
+OutputWriter::OutputWriter(std::string &out, size_t buffer)
+    : sink_(Sink::kString), str_(&out), buf_(std::max(buffer, kMaxNumberChars)), pos_(buf_.data()),
+      end_(buf_.data() + buf_.size()) {}
+
+OutputWriter::~OutputWriter() { flush(); }
+
+void OutputWriter::emit(const char *p, size_t n) {
+    if (!ok_ || n == 0) return;
+    switch (sink_) {
+    case Sink::kString:
+        str_->append(p, n);
+        break;
+    case Sink::kFile:
+        ok_ = std::fwrite(p, 1, n, file_) == n;
+        break;
+    case Sink::kFd:
+        while (n > 0) {
+#if defined(_WIN32)
+            int chunk = static_cast<int>(std::min<size_t>(n, size_t(1) << 30));
+            int got = ::_write(fd_, p, static_cast<unsigned>(chunk));
+#else
+            ssize_t got = ::write(fd_, p, n);
+#endif
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) {
+                ok_ = false;
+                return;
+            }
+            p += got;
+            n -= static_cast<size_t>(got);
+        }
+        break;
+    }
+}
+
+void OutputWriter::drain() {
+    emit(buf_.data(), static_cast<size_t>(pos_ - buf_.data()));
+    pos_ = buf_.data();
+}
+
+void OutputWriter::put(const char *s, size_t n) {
+    if (static_cast<size_t>(end_ - pos_) >= n) {
+        std::memcpy(pos_, s, n);
+        pos_ += n;
+        return;
+    }
+    drain();
+    if (n >= buf_.size()) {
+        emit(s, n);
+        return;
+    }
+    std::memcpy(pos_, s, n);
+    pos_ += n;
+}
+
+void OutputWriter::put_bytes(const void *p, size_t n) { put(static_cast<const char *>(p), n); }
+
+void OutputWriter::put_float(float v) {
+    if (!std::isfinite(v)) {
+        put("null");
+        return;
+    }
+    reserve(kMaxNumberChars);
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    pos_ = std::to_chars(pos_, pos_ + kMaxNumberChars, v).ptr;
+#else
+    // Toolchains without floating-point to_chars: nine significant digits also round-trip a float.
+    pos_ += std::snprintf(pos_, kMaxNumberChars, "%.9g", static_cast<double>(v));
+#endif
+}
+
+void OutputWriter::put_double(double v) {
+    if (!std::isfinite(v)) {
+        put("null");
+        return;
+    }
+    reserve(kMaxNumberChars);
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    pos_ = std::to_chars(pos_, pos_ + kMaxNumberChars, v).ptr;
+#else
+    pos_ += std::snprintf(pos_, kMaxNumberChars, "%.17g", v);
+#endif
+}
+
+void OutputWriter::put_json_string(const std::string &s) {
+    static const char kHex[] = "0123456789abcdef";
+    put('"');
+    size_t run = 0; // start of the pending run of characters that need no escaping
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c != '"' && c != '\\' && c >= 0x20) continue;
+        put(s.data() + run, i - run);
+        run = i + 1;
+        if (c == '"' || c == '\\') {
+            char esc[2] = {'\\', static_cast<char>(c)};
+            put(esc, 2);
+        } else {
+            char esc[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 15]};
+            put(esc, 6);
+        }
+    }
+    put(s.data() + run, s.size() - run);
+    put('"');
+}
+
+bool OutputWriter::flush() {
+    drain();
+    if (sink_ == Sink::kFile && ok_) ok_ = std::fflush(file_) == 0;
+    return ok_;
+}
+
+void write_layout_json(OutputWriter &w, const std::vector<LayoutPoint> &pts) {
+    w.put('[');
+    for (size_t i = 0; i < pts.size(); ++i) {
+        if (i) w.put(',');
+        write_layout_point(w, pts[i]);
+    }
+    w.put(']');
+}
+
+bool parse_output_format(const std::string &name, OutputFormat &out) {
+    if (name == "json") out = OutputFormat::kJson;
+    else if (name == "ndjson") out = OutputFormat::kNdjson;
+    else if (name == "binary") out = OutputFormat::kBinary;
+    else return false;
+    return true;
+}
+
+ResultWriter::ResultWriter(OutputWriter &w, OutputFormat format) : w_(w), format_(format) {
+    if (format_ == OutputFormat::kJson) {
+        w_.put('{');
+    } else if (format_ == OutputFormat::kBinary) {
+        w_.put_bytes(kBinaryMagic, sizeof(kBinaryMagic));
+        w_.put_bytes(&kBinaryVersion, sizeof(kBinaryVersion));
+        w_.put_bytes(&kEndianTag, sizeof(kEndianTag));
+    }
+}
+
+void ResultWriter::key(const char *name) {
+    if (format_ == OutputFormat::kJson) {
+        if (!first_) w_.put(',');
+        first_ = false;
+        w_.put('"');
+    } else {
+        w_.put("{\"");
+    }
+    w_.put(name, std::strlen(name));
+    w_.put("\":");
+}
+
+void ResultWriter::binary_header(const char *name, FieldKind kind, uint64_t count) {
+    size_t len = std::min<size_t>(std::strlen(name), 255);
+    uint8_t head[2] = {kind, static_cast<uint8_t>(len)};
+    w_.put_bytes(head, sizeof(head));
+    w_.put_bytes(name, len);
+    w_.put_bytes(&count, sizeof(count));
+}
+
+void ResultWriter::ndjson_array_header(const char *name, size_t n) {
+    w_.put("{\"array\":\"");
+    w_.put(name, std::strlen(name));
+    w_.put("\",\"count\":");
+    w_.put_uint(n);
+    w_.put("}\n");
+}
+
+void ResultWriter::end_scalar() {
+    if (format_ == OutputFormat::kNdjson) w_.put("}\n");
+}
+
+void ResultWriter::null(const char *name) {
+    if (format_ == OutputFormat::kBinary) {
+        binary_header(name, kNull, 0);
+        return;
+    }
+    key(name);
+    w_.put("null");
+    end_scalar();
+}
+
+void ResultWriter::field(const char *name, bool v) {
+    if (format_ == OutputFormat::kBinary) {
+        uint8_t b = v ? 1 : 0;
+        binary_header(name, kBool, 1);
+        w_.put_bytes(&b, 1);
+        return;
+    }
+    key(name);
+    w_.put_bool(v);
+    end_scalar();
+}
+
+void ResultWriter::field(const char *name, uint64_t v) {
+    if (format_ == OutputFormat::kBinary) {
+        binary_header(name, kUInt, 1);
+        w_.put_bytes(&v, sizeof(v));
+        return;
+    }
+    key(name);
+    w_.put_uint(v);
+    end_scalar();
+}
+
+void ResultWriter::field(const char *name, int64_t v) {
+    if (format_ == OutputFormat::kBinary) {
+        binary_header(name, kInt, 1);
+        w_.put_bytes(&v, sizeof(v));
+        return;
+    }
+    key(name);
+    w_.put_int(v);
+    end_scalar();
+}
+
+void ResultWriter::field(const char *name, double v) {
+    if (format_ == OutputFormat::kBinary) {
+        binary_header(name, kDouble, 1);
+        w_.put_bytes(&v, sizeof(v));
+        return;
+    }
+    key(name);
+    w_.put_double(v);
+    end_scalar();
+}
+
+void ResultWriter::field(const char *name, const std::string &v) {
+    if (format_ == OutputFormat::kBinary) {
+        binary_header(name, kString, v.size());
+        w_.put(v);
+        return;
+    }
+    key(name);
+    w_.put_json_string(v);
+    end_scalar();
+}
+
+void ResultWriter::array(const char *name, const uint32_t *v, size_t n) {
+    if (format_ == OutputFormat::kBinary) {
+        binary_header(name, kU32Array, n);
+        w_.put_bytes(v, n * sizeof(uint32_t));
+    } else if (format_ == OutputFormat::kNdjson) {
+        ndjson_array_header(name, n);
+        for (size_t i = 0; i < n; ++i) {
+            w_.put_uint(v[i]);
+            w_.put('\n');
+        }
+    } else {
+        key(name);
+        write_json_array(w_, v, n);
+    }
+}
+
+void ResultWriter::array(const char *name, const int32_t *v, size_t n) {
+    if (format_ == OutputFormat::kBinary) {
+        binary_header(name, kI32Array, n);
+        w_.put_bytes(v, n * sizeof(int32_t));
+    } else if (format_ == OutputFormat::kNdjson) {
+        ndjson_array_header(name, n);
+        for (size_t i = 0; i < n; ++i) {
+            w_.put_int(v[i]);
+            w_.put('\n');
+        }
+    } else {
+        key(name);
+        write_json_array(w_, v, n);
+    }
+}
+
+void ResultWriter::array(const char *name, const std::vector<int> &v) {
+    array(name, reinterpret_cast<const int32_t *>(v.data()), v.size());
+}
+
+void ResultWriter::layout(const char *name, const std::vector<LayoutPoint> &pts) {
+    if (format_ == OutputFormat::kBinary) {
+        binary_header(name, kLayout, pts.size());
+        w_.put_bytes(pts.data(), pts.size() * sizeof(LayoutPoint));
+    } else if (format_ == OutputFormat::kNdjson) {
+        ndjson_array_header(name, pts.size());
+        for (const LayoutPoint &p : pts) {
+            write_layout_point(w_, p);
+            w_.put('\n');
+        }
+    } else {
+        key(name);
+        write_layout_json(w_, pts);
+    }
+}
+
+void ResultWriter::finish() {
+    if (format_ == OutputFormat::kJson) w_.put("}\n");
+    else if (format_ == OutputFormat::kBinary) binary_header("", kEnd, 0);
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+struct LayoutPoint;
+
+// Buffered serializer for large results (topological orders, CSR h/list, layouts). Numbers are formatted with
+// std::to_chars straight into one reusable buffer that is handed to the sink whenever it fills, so a 10M-element array
+// streams to stdout or a file descriptor without ever existing as a single string. Floats take the shortest form that
+// reads back to the same value (NaN and infinities become null). The string sink appends to a caller-owned string
+// instead, for callers that need the bytes in memory (levels_to_json, the HTTP service).
+// Write errors are sticky: ok() turns false, later output is dropped, and flush() reports it.
+class OutputWriter {
+public:
+    static constexpr size_t kDefaultBuffer = size_t(1) << 16;
+
+    explicit OutputWriter(std::FILE *f, size_t buffer = kDefaultBuffer);
+    // POSIX write(2) (_write on Windows); the descriptor stays open.
+    explicit OutputWriter(int fd, size_t buffer = kDefaultBuffer);
+    explicit OutputWriter(std::string &out, size_t buffer = kDefaultBuffer);
+    ~OutputWriter(); // flushes; call flush() first to see whether that failed
+    OutputWriter(const OutputWriter &) = delete;
+    OutputWriter &operator=(const OutputWriter &) = delete;
+
+    void put(char c) {
+        reserve(1);
+        *pos_++ = c;
+    }
+    void put(const char *s, size_t n);
+    void put(const std::string &s) { put(s.data(), s.size()); }
+    template <size_t N>
+    void put(const char (&lit)[N]) {
+        put(lit, N - 1);
+    }
+    void put_uint(uint64_t v) {
+        reserve(20);
+        pos_ = std::to_chars(pos_, pos_ + 20, v).ptr;
+    }
+    void put_int(int64_t v) {
+        reserve(20);
+        pos_ = std::to_chars(pos_, pos_ + 20, v).ptr;
+    }
+    void put_bool(bool v) { v ? put("true") : put("false"); }
+    void put_float(float v);
+    void put_double(double v);
+    // JSON string literal with quotes, escaping '"', '\\' and control characters.
+    void put_json_string(const std::string &s);
+    // Raw bytes for the binary format; large blocks bypass the buffer.
+    void put_bytes(const void *p, size_t n);
+
+    bool flush();
+    bool ok() const { return ok_; }
+
+private:
+    enum class Sink : uint8_t { kFile, kFd, kString };
+
+    void reserve(size_t n) {
+        if (static_cast<size_t>(end_ - pos_) < n) drain();
+    }
+    void drain();                          // hands the buffered bytes to the sink
+    void emit(const char *p, size_t n);    // writes straight to the sink
+
+    Sink sink_;
+    std::FILE *file_{nullptr};
+    int fd_{-1};
+    std::string *str_{nullptr};
+    std::vector<char> buf_;
+    char *pos_;
+    char *end_;
+    bool ok_{true};
+};
+
+// [v0,v1,...] for any integer element type.
+template <class T>
+void write_json_array(OutputWriter &w, const T *values, size_t n) {
+    static_assert(std::is_integral<T>::value, "integer arrays only");
+    w.put('[');
+    for (size_t i = 0; i < n; ++i) {
+        if (i) w.put(',');
+        if (std::is_signed<T>::value) w.put_int(static_cast<int64_t>(values[i]));
+        else w.put_uint(static_cast<uint64_t>(values[i]));
+    }
+    w.put(']');
+}
+template <class T>
+void write_json_array(OutputWriter &w, const std::vector<T> &values) {
+    write_json_array(w, values.data(), values.size());
+}
+
+// [{"id":0,"x":..,"y":..,"z":..,"layer":0},...]
+void write_layout_json(OutputWriter &w, const std::vector<LayoutPoint> &pts);
+
+enum class OutputFormat : uint8_t { kJson, kNdjson, kBinary };
+
+// "json", "ndjson" or "binary"; false on anything else.
+bool parse_output_format(const std::string &name, OutputFormat &out);
+
+// A flat result document of named fields in one of three encodings:
+//   kJson    {"name":value,...} and a newline; arrays inline.
+//   kNdjson  one JSON line per field: scalars as {"name":value}; an array as an {"array":"name","count":N} header line
+//            followed by N lines of one element each, so consumers can process it incrementally.
+//   kBinary  kBinaryMagic, u32 version, u32 endian tag (0x01020304 as written), then per field: u8 kind (FieldKind),
+//            u8 name length, the name, u64 count, and the payload: one u64 / i64 / f64 for a number, one u8 for a bool,
+//            count elements of u32 / i32, count bytes of a string, or count layout points of {u32 id, f32 x, y, z,
+//            u32 layer}. Host byte order, which is little-endian on every supported target; the tag lets a reader
+//            check. Ends with a kEnd field.
+// Field names are literals chosen by the caller and are not escaped.
+class ResultWriter {
+public:
+    enum FieldKind : uint8_t {
+        kEnd = 0,
+        kNull = 1,
+        kBool = 2,
+        kUInt = 3, // count 1, one u64
+        kDouble = 4,
+        kString = 5,
+        kU32Array = 6,
+        kI32Array = 7,
+        kLayout = 8,
+        kInt = 9, // count 1, one i64
+    };
+    static constexpr char kBinaryMagic[8] = {'T', 'S', 'R', 'E', 'S', 'B', 'I', 'N'};
+    static constexpr uint32_t kBinaryVersion = 1;
+
+    ResultWriter(OutputWriter &w, OutputFormat format);
+
+    void null(const char *name);
+    void field(const char *name, bool v);
+    void field(const char *name, uint64_t v);
+    void field(const char *name, int64_t v);
+    // Any other integer type (uint32_t, int, size_t, ...) goes to the uint64_t or int64_t overload, so callers need no
+    // casts; bool keeps its own overload.
+    template <class T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+    void field(const char *name, T v) {
+        if (std::is_signed<T>::value) field(name, static_cast<int64_t>(v));
+        else field(name, static_cast<uint64_t>(v));
+    }
+    void field(const char *name, double v);
+    void field(const char *name, const std::string &v);
+    void field(const char *name, const char *v) { field(name, std::string(v)); } // not the bool overload
+    void array(const char *name, const uint32_t *v, size_t n);
+    void array(const char *name, const int32_t *v, size_t n);
+    void array(const char *name, const std::vector<uint32_t> &v) { array(name, v.data(), v.size()); }
+    void array(const char *name, const std::vector<int> &v);
+    void layout(const char *name, const std::vector<LayoutPoint> &pts);
+    // Closes the document; the OutputWriter still needs flush() for file and descriptor sinks.
+    void finish();
+
+private:
+    void key(const char *name); // "name": after a comma (json) or an opening brace (ndjson)
+    void end_scalar();
+    void binary_header(const char *name, FieldKind kind, uint64_t count);
+    void ndjson_array_header(const char *name, size_t n);
+
+    OutputWriter &w_;
+    OutputFormat format_;
+    bool first_{true};
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Threading is on by default; define TOPSORT_NO_THREADS for toolchains without std::thread (e.g. MinGW w/o gthreads).
+#ifndef TOPSORT_NO_THREADS
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#endif
+
+// Number of workers to use when the caller does not specify one.
+inline size_t default_worker_count() {
+#ifndef TOPSORT_NO_THREADS
+    unsigned hc = std::thread::hardware_concurrency();
+    return hc == 0 ? 1 : static_cast<size_t>(hc);
+#else
+    return 1;
+#endif
+}
+
+// Run fn(worker_id) on `workers` threads (worker 0 is the calling thread) and join.
+template <class Fn>
+void run_workers(size_t workers, Fn &&fn) {
+#ifndef TOPSORT_NO_THREADS
+    if (workers <= 1) { fn(size_t{0}); return; }
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (size_t w = 1; w < workers; ++w) pool.emplace_back([&fn, w] { fn(w); });
+    fn(size_t{0});
+    for (auto &t : pool) t.join();
+#else
+    for (size_t w = 0; w < workers; ++w) fn(w);
+#endif
+}
+
+// Static block partition of [0, count) over workers: fn(worker_id, begin, end).
+template <class Fn>
+void parallel_for(size_t count, size_t workers, Fn &&fn) {
+    workers = std::max<size_t>(1, std::min(workers, count));
+    if (count == 0) return;
+    run_workers(workers, [&](size_t w) {
+        size_t begin = count * w / workers;
+        size_t end = count * (w + 1) / workers;
+        fn(w, begin, end);
+    });
+}
+
+// Yield hint used by spin-waits in worker loops.
+inline void cpu_relax() {
+#ifndef TOPSORT_NO_THREADS
+    std::this_thread::yield();
+#endif
+}
+
+#ifndef TOPSORT_NO_THREADS
+// Epoch counter for handing rounds of work to parked workers. wait_past() spins briefly (cheap when the next round
+// follows at once) and then sleeps on a condition variable, so idle workers cost nothing while the leader runs a long
+// stretch alone. advance() only takes the mutex when someone is asleep.
+class EpochSignal {
+public:
+    static constexpr int kSpins = 128;
+
+    uint64_t load() const { return epoch_.load(std::memory_order_acquire); }
+
+    // Returns the first epoch different from `seen`.
+    uint64_t wait_past(uint64_t seen) {
+        for (int i = 0; i < kSpins; ++i) {
+            uint64_t e = load();
+            if (e != seen) return e;
+            cpu_relax();
+        }
+        std::unique_lock<std::mutex> lock(mu_);
+        sleepers_.fetch_add(1); // seq_cst with advance(): either it sees a sleeper or we see its epoch
+        cv_.wait(lock, [&] { return epoch_.load() != seen; });
+        sleepers_.fetch_sub(1);
+        return load();
+    }
+
+    void advance() {
+        epoch_.fetch_add(1);
+        if (sleepers_.load() == 0) return;
+        std::lock_guard<std::mutex> lock(mu_);
+        cv_.notify_all();
+    }
+
+private:
+    std::atomic<uint64_t> epoch_{0};
+    std::atomic<uint32_t> sleepers_{0};
+    std::mutex mu_;
+    std::condition_variable cv_;
+};
+#endif
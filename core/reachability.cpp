@@ -0,0 +1,185 @@
+#include "reachability.hpp"
+#include "csr_builder.hpp"
+#include "topo_kernels.hpp"
+#include "toposort.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+using node_t = GraphInterface::node_t;
+
+// Levels narrower than this are filled on the calling thread. A row costs several words per edge, so this is lower
+// than the per-node cutoffs elsewhere.
+constexpr size_t kClosureMinParallelWidth = 1024;
+
+struct Placement {
+    bool has_cycle{false};
+    TopoLevels levels;
+    std::vector<uint32_t> position; // index into levels.nodes
+};
+
+Placement place(CsrView &g, size_t workers) {
+    Placement p;
+    LayeredTopoSolver solver(g, workers);
+    p.has_cycle = solver.run_levels(p.levels);
+    if (!p.has_cycle) {
+        p.position.resize(g.node_count());
+        for (size_t i = 0; i < p.levels.nodes.size(); ++i) p.position[p.levels.nodes[i]] = static_cast<uint32_t>(i);
+    }
+    return p;
+}
+
+// Words per closure row such that n rows stay within max_bytes (at least one word, at most a full row).
+size_t window_words(size_t n, size_t max_bytes) {
+    size_t full = (n + 63) / 64;
+    size_t fit = max_bytes / (8 * std::max<size_t>(n, 1));
+    return std::max<size_t>(1, std::min(full, fit));
+}
+
+// One window of target positions [lo, hi), hi - lo <= 64 * words: row p of rows gets bit t - lo for every target
+// position t reachable from the node at position p < hi by one or more edges; nodes placed at hi or later cannot
+// reach the window and get no row. visit(u, row) sees u's row when it holds only the targets reachable through a
+// successor, i.e. by two or more edges, before u's own successors are added.
+template <class Visit>
+void closure_window(const CsrView &g, const Placement &pl, uint32_t lo, uint32_t hi, size_t words,
+                    std::vector<uint64_t> &rows, size_t workers, Visit &&visit) {
+    const TopoLevels &lv = pl.levels;
+    rows.assign(size_t(hi) * words, 0);
+    auto fill = [&](size_t i) {
+        node_t u = lv.nodes[i];
+        uint64_t *row = rows.data() + i * words;
+        auto span = g.neighbor_span(u);
+        for (auto it = span.first; it != span.second; ++it) {
+            uint32_t q = pl.position[*it];
+            if (q >= hi) continue;
+            // Row q holds only positions after q, so the words before that are zero.
+            size_t first = q + 1 <= lo ? 0 : (q + 1 - lo) / 64;
+            const uint64_t *src = rows.data() + size_t(q) * words;
+            for (size_t w = first; w < words; ++w) row[w] |= src[w];
+        }
+        visit(u, static_cast<const uint64_t *>(row));
+        for (auto it = span.first; it != span.second; ++it) {
+            uint32_t q = pl.position[*it];
+            if (q >= lo && q < hi) row[(q - lo) / 64] |= uint64_t(1) << ((q - lo) % 64);
+        }
+    };
+    for (size_t k = lv.level_count(); k-- > 0;) {
+        size_t begin = lv.offsets[k];
+        size_t end = std::min<size_t>(lv.offsets[k + 1], hi);
+        if (begin >= end) continue;
+        if (workers <= 1 || end - begin < kClosureMinParallelWidth) {
+            for (size_t i = begin; i < end; ++i) fill(i);
+            continue;
+        }
+        parallel_for(end - begin, workers, [&](size_t, size_t b, size_t e) {
+            for (size_t i = begin + b; i < begin + e; ++i) fill(i);
+        });
+    }
+}
+
+bool test_bit(const uint64_t *row, size_t bit) { return (row[bit / 64] >> (bit % 64)) & 1; }
+} // namespace
+
+ReductionResult transitive_reduction(const GraphInterface &g, CompressedGraph &out, size_t workers, size_t max_bytes) {
+    ReductionResult r;
+    CsrView view = csr_of(g);
+    r.edges_before = view.edge_count();
+    Placement pl = place(view, workers);
+    if (pl.has_cycle) {
+        r.has_cycle = true;
+        return r;
+    }
+
+    size_t n = view.node_count();
+    const uint32_t *off = view.offsets();
+    const node_t *nbr = view.neighbors();
+    size_t words = window_words(n, max_bytes);
+    std::vector<uint8_t> redundant(view.edge_count(), 0);
+    std::vector<uint64_t> rows;
+    for (size_t lo = 0; lo < n; lo += words * 64) {
+        uint32_t lo32 = static_cast<uint32_t>(lo);
+        uint32_t hi = static_cast<uint32_t>(std::min(n, lo + words * 64));
+        // Each edge is written only by the worker that owns its source row.
+        closure_window(view, pl, lo32, hi, words, rows, workers, [&](node_t u, const uint64_t *row) {
+            for (uint32_t i = off[u]; i < off[u + 1]; ++i) {
+                uint32_t q = pl.position[nbr[i]];
+                if (q >= lo32 && q < hi && test_bit(row, q - lo32)) redundant[i] = 1;
+            }
+        });
+        ++r.batches;
+    }
+
+    CsrData csr;
+    csr.offsets.assign(n + 1, 0);
+    csr.neighbors.reserve(view.edge_count());
+    for (node_t u = 0; u < n; ++u) {
+        for (uint32_t i = off[u]; i < off[u + 1]; ++i) {
+            if (!redundant[i]) csr.neighbors.push_back(nbr[i]);
+        }
+        csr.offsets[u + 1] = static_cast<uint32_t>(csr.neighbors.size());
+    }
+    sort_dedup_rows(csr, workers);
+    r.edges_removed = r.edges_before - csr.neighbors.size();
+    out.build_from_csr(std::move(csr));
+    return r;
+}
+
+ReachabilityIndex::ReachabilityIndex(const GraphInterface &g, size_t workers, size_t max_bytes)
+    : graph_(csr_of(g)) {
+    size_t n = graph_.node_count();
+    Placement pl = place(graph_, workers);
+    has_cycle_ = pl.has_cycle;
+    mark_.assign(n, 0);
+    if (has_cycle_) return;
+
+    level_.resize(n);
+    for (size_t k = 0; k < pl.levels.level_count(); ++k) {
+        for (uint32_t i = pl.levels.offsets[k]; i < pl.levels.offsets[k + 1]; ++i) {
+            level_[pl.levels.nodes[i]] = static_cast<uint32_t>(k);
+        }
+    }
+    size_t full = (n + 63) / 64;
+    if (n != 0 && full <= max_bytes / 8 / n) {
+        words_per_row_ = full;
+        closure_window(graph_, pl, 0, static_cast<uint32_t>(n), full, closure_, workers,
+                       [](node_t, const uint64_t *) {});
+    }
+    position_ = std::move(pl.position);
+}
+
+bool ReachabilityIndex::reaches(node_t a, node_t b) const {
+    if (a >= graph_.node_count() || b >= graph_.node_count()) throw std::out_of_range("node id out of range");
+    if (a == b) return true;
+    if (has_cycle_) return search(a, b);
+    if (position_[a] >= position_[b]) return false;
+    if (full_closure()) return test_bit(closure_.data() + size_t(position_[a]) * words_per_row_, position_[b]);
+    return search(a, b);
+}
+
+bool ReachabilityIndex::search(node_t a, node_t b) const {
+    if (++epoch_ == 0) {
+        std::fill(mark_.begin(), mark_.end(), 0);
+        epoch_ = 1;
+    }
+    uint32_t limit = has_cycle_ ? UINT32_MAX : level_[b];
+    stack_.assign(1, a);
+    mark_[a] = epoch_;
+    while (!stack_.empty()) {
+        node_t u = stack_.back();
+        stack_.pop_back();
+        auto span = graph_.neighbor_span(u);
+        for (auto it = span.first; it != span.second; ++it) {
+            node_t v = *it;
+            if (v == b) return true;
+            if (mark_[v] == epoch_ || (!has_cycle_ && level_[v] >= limit)) continue;
+            mark_[v] = epoch_;
+            stack_.push_back(v);
+        }
+    }
+    return false;
+}
+
+size_t ReachabilityIndex::bytes() const {
+    return closure_.size() * sizeof(uint64_t) + (position_.size() + level_.size() + mark_.size()) * sizeof(uint32_t);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "compressed_graph.hpp"
+#include "parallel.hpp"
+
+#include <vector>
+
+// Transitive closure of a DAG as 64-bit word-parallel bitsets. Nodes are placed by topological position (the levels
+// of LayeredTopoSolver), so a node reaches only positions after its own, and the closure row of u is the OR over its
+// successors v of (row v | bit v), filled from the last level back; every node of a level depends only on later
+// levels, so wide levels are split across workers.
+// A full closure takes n^2 / 8 bytes. Under max_bytes the target positions are processed in batches instead: each pass
+// keeps only the bits for one window of targets (and only rows of nodes placed before the window's end), so memory is
+// bounded at the price of one sweep over the edges per batch.
+
+// Closure memory used when the caller does not give a cap.
+constexpr size_t kDefaultClosureBytes = size_t(256) << 20;
+
+struct ReductionResult {
+    bool has_cycle{false};
+    size_t edges_before{0};
+    size_t edges_removed{0};
+    size_t batches{0}; // target windows the closure was split into to fit max_bytes
+};
+
+// Transitive reduction: edge u->v is dropped when v is also reachable through another successor of u. The reduction
+// of a DAG is unique and keeps its reachability (and therefore its topological orders). On a cycle only has_cycle is
+// set and out is left untouched. Time O(m * n / 64) word operations, space min(max_bytes, n^2 / 8) plus O(n + m).
+ReductionResult transitive_reduction(const GraphInterface &g, CompressedGraph &out,
+                                     size_t workers = default_worker_count(), size_t max_bytes = kDefaultClosureBytes);
+
+// Reachability queries on a snapshot of the graph. When the full closure fits in max_bytes a query is one bit test;
+// otherwise it is a DFS from a that skips every node whose topological level is not below b's (a node on a path to b
+// has a smaller level), plus an O(1) rejection when a is not placed before b. On a cycle the pruning is off and every
+// query is a plain DFS. Queries in search mode share scratch space, so only full-closure queries may run concurrently.
+class ReachabilityIndex {
+public:
+    using node_t = GraphInterface::node_t;
+
+    explicit ReachabilityIndex(const GraphInterface &g, size_t workers = default_worker_count(),
+                               size_t max_bytes = kDefaultClosureBytes);
+
+    // True when there is a path of zero or more edges from a to b. Throws std::out_of_range on a bad id.
+    bool reaches(node_t a, node_t b) const;
+    bool has_cycle() const { return has_cycle_; }
+    bool full_closure() const { return words_per_row_ != 0; }
+    size_t bytes() const;
+
+private:
+    bool search(node_t a, node_t b) const;
+
+    CsrView graph_;
+    bool has_cycle_{false};
+    std::vector<uint32_t> position_; // topological position
+    std::vector<uint32_t> level_;
+    size_t words_per_row_{0};
+    std::vector<uint64_t> closure_; // row of position p: words [p * words_per_row_, (p + 1) * words_per_row_)
+
+    mutable std::vector<uint32_t> mark_;
+    mutable uint32_t epoch_{0};
+    mutable std::vector<node_t> stack_;
+};
@@ -0,0 +1,191 @@
+#include "reorder.hpp"
+#include "csr_builder.hpp"
+#include "topo_kernels.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+using node_t = GraphInterface::node_t;
+
+std::vector<uint32_t> in_degrees(const CsrView &g) {
+    std::vector<uint32_t> indeg(g.node_count(), 0);
+    for (size_t i = 0; i < g.edge_count(); ++i) indeg[g.neighbors()[i]]++;
+    return indeg;
+}
+
+uint32_t out_degree(const CsrView &g, node_t u) { return g.offsets()[u + 1] - g.offsets()[u]; }
+
+std::vector<node_t> bfs_order(const CsrView &g) {
+    size_t n = g.node_count();
+    std::vector<uint32_t> indeg = in_degrees(g);
+    std::vector<uint8_t> seen(n, 0);
+    std::vector<node_t> order;
+    order.reserve(n);
+    auto sweep = [&](node_t root) {
+        if (seen[root]) return;
+        seen[root] = 1;
+        size_t head = order.size();
+        order.push_back(root);
+        for (; head < order.size(); ++head) {
+            g.for_each_neighbor(order[head], [&](node_t v) {
+                if (!seen[v]) {
+                    seen[v] = 1;
+                    order.push_back(v);
+                }
+            });
+        }
+    };
+    for (node_t u = 0; u < n; ++u) if (indeg[u] == 0) sweep(u);
+    for (node_t u = 0; u < n; ++u) sweep(u);
+    return order;
+}
+
+std::vector<node_t> rcm_order(const CsrView &g) {
+    size_t n = g.node_count();
+    // Transpose so each node sees both directions.
+    std::vector<uint32_t> indeg = in_degrees(g);
+    std::vector<uint32_t> in_offsets;
+    parallel_exclusive_scan(indeg, in_offsets, 1);
+    std::vector<node_t> in_nbrs(g.edge_count());
+    {
+        std::vector<uint32_t> cursor(in_offsets.begin(), in_offsets.end() - 1);
+        for (node_t u = 0; u < n; ++u) g.for_each_neighbor(u, [&](node_t v) { in_nbrs[cursor[v]++] = u; });
+    }
+    auto degree = [&](node_t u) { return out_degree(g, u) + indeg[u]; };
+    auto by_degree = [&](node_t a, node_t b) {
+        uint32_t da = degree(a), db = degree(b);
+        return da != db ? da < db : a < b;
+    };
+
+    std::vector<node_t> starts(n);
+    std::iota(starts.begin(), starts.end(), node_t{0});
+    std::sort(starts.begin(), starts.end(), by_degree);
+
+    std::vector<uint8_t> seen(n, 0);
+    std::vector<node_t> order;
+    order.reserve(n);
+    for (node_t root : starts) {
+        if (seen[root]) continue;
+        seen[root] = 1;
+        size_t head = order.size();
+        order.push_back(root);
+        for (; head < order.size(); ++head) {
+            node_t u = order[head];
+            size_t level_begin = order.size();
+            auto visit = [&](node_t v) {
+                if (!seen[v]) {
+                    seen[v] = 1;
+                    order.push_back(v);
+                }
+            };
+            g.for_each_neighbor(u, visit);
+            for (uint32_t i = in_offsets[u]; i < in_offsets[u + 1]; ++i) visit(in_nbrs[i]);
+            std::sort(order.begin() + static_cast<std::ptrdiff_t>(level_begin), order.end(), by_degree);
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+std::vector<node_t> degree_order(const CsrView &g) {
+    size_t n = g.node_count();
+    std::vector<uint32_t> degree = in_degrees(g);
+    for (node_t u = 0; u < n; ++u) degree[u] += out_degree(g, u);
+    std::vector<node_t> order(n);
+    std::iota(order.begin(), order.end(), node_t{0});
+    std::stable_sort(order.begin(), order.end(), [&](node_t a, node_t b) { return degree[a] > degree[b]; });
+    return order;
+}
+
+std::vector<node_t> level_order(const CsrView &g, std::vector<node_t> topo) {
+    size_t n = g.node_count();
+    if (topo.empty()) {
+        std::vector<uint32_t> indeg;
+        kernels::indegrees(g, indeg);
+        kernels::kahn(g, indeg, topo); // partial on a cycle
+    }
+    std::vector<uint32_t> layer;
+    kernels::layers(g, topo, layer);
+
+    // Counting sort by layer keeps the previous order within a layer.
+    uint32_t depth = 0;
+    for (node_t u : topo) depth = std::max(depth, layer[u] + 1);
+    std::vector<uint32_t> bucket(depth + 1, 0);
+    for (node_t u : topo) bucket[layer[u] + 1]++;
+    for (size_t i = 1; i < bucket.size(); ++i) bucket[i] += bucket[i - 1];
+    std::vector<node_t> order(topo.size());
+    for (node_t u : topo) order[bucket[layer[u]]++] = u;
+
+    if (order.size() < n) {
+        std::vector<uint8_t> placed(n, 0);
+        for (node_t u : order) placed[u] = 1;
+        for (node_t u = 0; u < n; ++u) if (!placed[u]) order.push_back(u);
+    }
+    return order;
+}
+}
+
+const char *reorder_strategy_name(ReorderStrategy s) {
+    switch (s) {
+    case ReorderStrategy::kNone: return "none";
+    case ReorderStrategy::kBfs: return "bfs";
+    case ReorderStrategy::kRcm: return "rcm";
+    case ReorderStrategy::kDegree: return "degree";
+    case ReorderStrategy::kLevel: return "level";
+    }
+    return "none";
+}
+
+bool parse_reorder_strategy(const std::string &name, ReorderStrategy &out) {
+    for (ReorderStrategy s : {ReorderStrategy::kNone, ReorderStrategy::kBfs, ReorderStrategy::kRcm,
+                              ReorderStrategy::kDegree, ReorderStrategy::kLevel}) {
+        if (name == reorder_strategy_name(s)) {
+            out = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+Relabeling compute_relabeling(const GraphInterface &g, ReorderStrategy s, const std::vector<node_t> &topo) {
+    CsrView csr = csr_of(g);
+    size_t n = csr.node_count();
+    Relabeling r;
+    switch (s) {
+    case ReorderStrategy::kNone:
+        r.old_id.resize(n);
+        std::iota(r.old_id.begin(), r.old_id.end(), node_t{0});
+        break;
+    case ReorderStrategy::kBfs: r.old_id = bfs_order(csr); break;
+    case ReorderStrategy::kRcm: r.old_id = rcm_order(csr); break;
+    case ReorderStrategy::kDegree: r.old_id = degree_order(csr); break;
+    case ReorderStrategy::kLevel: r.old_id = level_order(csr, topo); break;
+    }
+    r.new_id.assign(n, 0);
+    for (size_t i = 0; i < n; ++i) r.new_id[r.old_id[i]] = static_cast<node_t>(i);
+    return r;
+}
+
+void relabel_csr(const GraphInterface &g, const Relabeling &r, CsrData &out, size_t workers) {
+    CsrView csr = csr_of(g);
+    size_t n = csr.node_count();
+    out.offsets.assign(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) out.offsets[i + 1] = out.offsets[i] + out_degree(csr, r.old_id[i]);
+    out.neighbors.resize(csr.edge_count());
+    parallel_for(n, workers, [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            node_t *dst = out.neighbors.data() + out.offsets[i];
+            csr.for_each_neighbor(r.old_id[i], [&](node_t v) { *dst++ = r.new_id[v]; });
+        }
+    });
+    sort_dedup_rows(out, workers);
+}
+
+ReorderedGraph::ReorderedGraph(const GraphInterface &g, ReorderStrategy s, const std::vector<node_t> &topo) {
+    CsrView csr = csr_of(g); // copy non-CSR storage once, not once per pass
+    relabeling_ = compute_relabeling(csr, s, topo);
+    CsrData data;
+    relabel_csr(csr, relabeling_, data);
+    graph_.build_from_csr(std::move(data));
+}
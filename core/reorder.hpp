@@ -0,0 +1,56 @@
+#pragma once
+
+#include "compressed_graph.hpp"
+#include "parallel.hpp"
+
+#include <string>
+#include <vector>
+
+// Optional relabeling pass before solving. Real-world ids scatter a solver's indeg[v] / offsets[v] accesses across
+// memory; renumbering nodes so that nodes visited together get nearby ids turns those into mostly sequential
+// accesses and also shrinks the deltas stored in the varint rows.
+enum class ReorderStrategy {
+    kNone,   // identity
+    kBfs,    // directed BFS from each source (indegree 0) in id order, then any nodes left over (cycles)
+    kRcm,    // reverse Cuthill-McKee on the undirected graph (bandwidth reduction)
+    kDegree, // total degree, highest first (hubs share cache lines)
+    kLevel,  // topological level of a previous order, ties by position in that order
+};
+
+const char *reorder_strategy_name(ReorderStrategy s);
+bool parse_reorder_strategy(const std::string &name, ReorderStrategy &out);
+
+// A permutation of node ids: new_id[old] and its inverse old_id[new].
+struct Relabeling {
+    std::vector<GraphInterface::node_t> new_id;
+    std::vector<GraphInterface::node_t> old_id;
+
+    // Rewrite ids of the relabeled graph (e.g. a topological order) back to original ids, in place.
+    void map_back(std::vector<GraphInterface::node_t> &ids) const {
+        for (auto &x : ids) x = old_id[x];
+    }
+};
+
+// Compute the relabeling for g. For kLevel, `topo` is a previous order of g in original ids; when empty one is
+// computed with Kahn (nodes on a cycle go last).
+Relabeling compute_relabeling(const GraphInterface &g, ReorderStrategy s,
+                              const std::vector<GraphInterface::node_t> &topo = {});
+
+// CSR of g with every id replaced by r.new_id; rows come out sorted.
+void relabel_csr(const GraphInterface &g, const Relabeling &r, CsrData &out, size_t workers = default_worker_count());
+
+// Relabeled copy of a graph together with its mapping. Run any solver on graph(), then map_back() the order it
+// produced; the result is a valid order of the original graph. Lexicographic solvers order by the new ids, so use
+// kNone with them.
+class ReorderedGraph {
+public:
+    ReorderedGraph(const GraphInterface &g, ReorderStrategy s, const std::vector<GraphInterface::node_t> &topo = {});
+
+    CompressedGraph &graph() { return graph_; }
+    const Relabeling &relabeling() const { return relabeling_; }
+    void map_back(std::vector<GraphInterface::node_t> &order) const { relabeling_.map_back(order); }
+
+private:
+    Relabeling relabeling_;
+    CompressedGraph graph_;
+};
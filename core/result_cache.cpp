@@ -0,0 +1,319 @@
+#include "result_cache.hpp"
+#include "csr_builder.hpp"
+#include "hash.hpp"
+#include "parallel.hpp"
+#include "topo_kernels.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+using node_t = GraphInterface::node_t;
+
+// Spill file: kMagic, payload, hash_bytes64(payload). Host byte order; the directory is a cache for this machine.
+constexpr char kMagic[8] = {'T', 'S', 'R', 'E', 'S', 'U', 'L', 'T'};
+// Bookkeeping charged to every entry on top of its arrays.
+constexpr size_t kEntryOverhead = 128;
+
+uint32_t float_bits(float f) {
+    uint32_t b;
+    std::memcpy(&b, &f, sizeof(b));
+    return b;
+}
+
+size_t result_bytes(const ResultKey &key, const CachedResult &r) {
+    return kEntryOverhead + key.algorithm.size() + r.order.size() * sizeof(uint32_t) +
+           (r.levels.offsets.size() + r.levels.nodes.size()) * sizeof(uint32_t) + r.layout.size() * sizeof(LayoutPoint);
+}
+
+class Writer {
+public:
+    template <class T>
+    void put(const T &v) {
+        const char *p = reinterpret_cast<const char *>(&v);
+        buf_.append(p, sizeof(T));
+    }
+    void put_u32s(const std::vector<uint32_t> &v) {
+        put(static_cast<uint64_t>(v.size()));
+        buf_.append(reinterpret_cast<const char *>(v.data()), v.size() * sizeof(uint32_t));
+    }
+    const std::string &bytes() const { return buf_; }
+
+private:
+    std::string buf_;
+};
+
+class Reader {
+public:
+    Reader(const char *p, size_t n) : p_(p), end_(p + n) {}
+    template <class T>
+    bool get(T &v) {
+        if (static_cast<size_t>(end_ - p_) < sizeof(T)) return false;
+        std::memcpy(&v, p_, sizeof(T));
+        p_ += sizeof(T);
+        return true;
+    }
+    bool get_u32s(std::vector<uint32_t> &v) {
+        uint64_t n;
+        if (!get(n) || n > static_cast<uint64_t>(end_ - p_) / sizeof(uint32_t)) return false;
+        v.resize(static_cast<size_t>(n));
+        std::memcpy(v.data(), p_, v.size() * sizeof(uint32_t));
+        p_ += v.size() * sizeof(uint32_t);
+        return true;
+    }
+    bool done() const { return p_ == end_; }
+
+private:
+    const char *p_;
+    const char *end_;
+};
+
+void put_key(Writer &w, const ResultKey &key) {
+    w.put(key.fingerprint);
+    w.put(static_cast<uint32_t>(key.algorithm.size()));
+    for (char c : key.algorithm) w.put(c);
+    w.put(static_cast<uint8_t>(key.with_layout));
+    w.put(key.layout.layer_gap);
+    w.put(key.layout.radius_base);
+    w.put(key.layout.radius_step);
+}
+
+bool get_key(Reader &r, ResultKey &key) {
+    uint32_t len;
+    uint8_t with_layout;
+    if (!r.get(key.fingerprint) || !r.get(len) || len > 256) return false;
+    key.algorithm.resize(len);
+    for (char &c : key.algorithm) {
+        if (!r.get(c)) return false;
+    }
+    if (!r.get(with_layout)) return false;
+    key.with_layout = with_layout != 0;
+    return r.get(key.layout.layer_gap) && r.get(key.layout.radius_base) && r.get(key.layout.radius_step);
+}
+
+std::string encode(const ResultKey &key, const CachedResult &res) {
+    Writer w;
+    put_key(w, key);
+    w.put(static_cast<uint8_t>(res.has_cycle));
+    w.put_u32s(res.order);
+    w.put_u32s(res.levels.offsets);
+    w.put_u32s(res.levels.nodes);
+    w.put(static_cast<uint64_t>(res.layout.size()));
+    for (const LayoutPoint &p : res.layout) {
+        w.put(p.id);
+        w.put(p.x);
+        w.put(p.y);
+        w.put(p.z);
+        w.put(p.layer);
+    }
+    return w.bytes();
+}
+
+bool decode(const std::string &payload, ResultKey &key, CachedResult &res) {
+    Reader r(payload.data(), payload.size());
+    uint8_t has_cycle;
+    uint64_t points;
+    if (!get_key(r, key) || !r.get(has_cycle) || !r.get_u32s(res.order) || !r.get_u32s(res.levels.offsets) ||
+        !r.get_u32s(res.levels.nodes) || !r.get(points)) {
+        return false;
+    }
+    res.has_cycle = has_cycle != 0;
+    if (points > payload.size() / (5 * sizeof(uint32_t))) return false;
+    res.layout.resize(static_cast<size_t>(points));
+    for (LayoutPoint &p : res.layout) {
+        if (!r.get(p.id) || !r.get(p.x) || !r.get(p.y) || !r.get(p.z) || !r.get(p.layer)) return false;
+    }
+    return r.done();
+}
+
+bool read_file(const std::string &path, std::string &out) {
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char buf[1 << 16];
+    size_t got;
+    out.clear();
+    while ((got = std::fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, got);
+    bool ok = !std::ferror(f);
+    std::fclose(f);
+    return ok;
+}
+
+bool write_file(const std::string &path, const std::string &bytes) {
+    std::string tmp = path + ".tmp";
+    std::FILE *f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (ok) ok = std::rename(tmp.c_str(), path.c_str()) == 0;
+    if (!ok) std::remove(tmp.c_str());
+    return ok;
+}
+} // namespace
+
+bool ResultKey::operator==(const ResultKey &o) const {
+    if (fingerprint != o.fingerprint || algorithm != o.algorithm || with_layout != o.with_layout) return false;
+    if (!with_layout) return true;
+    return float_bits(layout.layer_gap) == float_bits(o.layout.layer_gap) &&
+           float_bits(layout.radius_base) == float_bits(o.layout.radius_base) &&
+           float_bits(layout.radius_step) == float_bits(o.layout.radius_step);
+}
+
+uint64_t ResultKey::hash() const {
+    Hash64 h;
+    uint8_t flag = with_layout;
+    h.update(&fingerprint, sizeof(fingerprint)).update(&flag, 1).update(algorithm.data(), algorithm.size());
+    if (with_layout) {
+        uint32_t bits[3] = {float_bits(layout.layer_gap), float_bits(layout.radius_base), float_bits(layout.radius_step)};
+        h.update(bits, sizeof(bits));
+    }
+    return h.finish();
+}
+
+uint64_t fingerprint_of(const GraphInterface &g) {
+    if (auto *cg = dynamic_cast<const CompressedGraph *>(&g)) return cg->fingerprint();
+    CsrView view = csr_of(g);
+    return graph_fingerprint(view.node_count(),
+                             csr_edge_hash_sum(view.offsets(), view.neighbors(), view.node_count()));
+}
+
+ResultCache::ResultCache(ResultCacheOptions opt) : opt_(std::move(opt)) {}
+
+ResultCache::ResultPtr ResultCache::lookup(const ResultKey &key) {
+    {
+        SpinGuard guard(lock_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            ++stats_.hits;
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->result;
+        }
+        if (opt_.spill_dir.empty()) {
+            ++stats_.misses;
+            return nullptr;
+        }
+    }
+
+    std::string bytes;
+    ResultKey stored;
+    auto res = std::make_shared<CachedResult>();
+    bool found = read_file(spill_path(key), bytes) && bytes.size() >= sizeof(kMagic) + sizeof(uint64_t) &&
+                 std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) == 0;
+    if (found) {
+        std::string payload = bytes.substr(sizeof(kMagic), bytes.size() - sizeof(kMagic) - sizeof(uint64_t));
+        uint64_t checksum;
+        std::memcpy(&checksum, bytes.data() + bytes.size() - sizeof(uint64_t), sizeof(checksum));
+        found = checksum == hash_bytes64(payload.data(), payload.size()) && decode(payload, stored, *res) &&
+                stored == key;
+    }
+    std::vector<Entry> evicted;
+    ResultPtr result;
+    {
+        SpinGuard guard(lock_);
+        if (!found) {
+            ++stats_.misses;
+            return nullptr;
+        }
+        ++stats_.disk_hits;
+        result = std::move(res);
+        insert_locked(key, result, true, evicted);
+    }
+    spill(evicted);
+    return result;
+}
+
+void ResultCache::store(const ResultKey &key, ResultPtr result) {
+    std::vector<Entry> evicted;
+    {
+        SpinGuard guard(lock_);
+        insert_locked(key, std::move(result), false, evicted);
+    }
+    spill(evicted);
+}
+
+void ResultCache::insert_locked(const ResultKey &key, ResultPtr result, bool on_disk, std::vector<Entry> &evicted) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return; // computed concurrently; keep the first
+    }
+    size_t bytes = result_bytes(key, *result);
+    lru_.push_front(Entry{key, std::move(result), bytes, on_disk});
+    index_.emplace(key, lru_.begin());
+    bytes_ += bytes;
+    while (bytes_ > opt_.max_bytes && !lru_.empty()) {
+        Entry &victim = lru_.back();
+        bytes_ -= victim.bytes;
+        index_.erase(victim.key);
+        ++stats_.evictions;
+        if (!opt_.spill_dir.empty() && !victim.on_disk) evicted.push_back(std::move(victim));
+        lru_.pop_back();
+    }
+}
+
+std::string ResultCache::spill_path(const ResultKey &key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.tsr", static_cast<unsigned long long>(key.hash()));
+    return opt_.spill_dir + name;
+}
+
+void ResultCache::spill(const std::vector<Entry> &evicted) {
+    size_t written = 0;
+    for (const Entry &e : evicted) {
+        std::string payload = encode(e.key, *e.result);
+        uint64_t checksum = hash_bytes64(payload.data(), payload.size());
+        std::string bytes(kMagic, sizeof(kMagic));
+        bytes += payload;
+        bytes.append(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+        if (write_file(spill_path(e.key), bytes)) ++written;
+    }
+    if (written == 0) return;
+    SpinGuard guard(lock_);
+    stats_.spilled += written;
+}
+
+ResultCacheStats ResultCache::stats() const {
+    SpinGuard guard(lock_);
+    ResultCacheStats s = stats_;
+    s.entries = lru_.size();
+    s.bytes = bytes_;
+    return s;
+}
+
+void ResultCache::clear() {
+    SpinGuard guard(lock_);
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+    stats_ = ResultCacheStats{};
+}
+
+ResultCache::ResultPtr solve_cached(ResultCache &cache, GraphInterface &g, uint64_t fingerprint,
+                                    const std::string &algorithm, const LayoutParams *layout, bool *hit,
+                                    size_t workers) {
+    ResultKey key;
+    key.fingerprint = fingerprint;
+    key.algorithm = algorithm;
+    key.with_layout = layout != nullptr;
+    if (layout) key.layout = *layout;
+    return cache.get_or_compute(key, [&](CachedResult &r) {
+        if (algorithm == "dfs") {
+            r.has_cycle = DFSTopoSolver(g).run(r.order);
+        } else if (algorithm == "kahn") {
+            r.has_cycle = KahnTopoSolver(g).run(r.order);
+        } else if (algorithm == "parallel") {
+            r.has_cycle = ParallelKahnSolver(g, workers).run(r.order);
+        } else if (algorithm == "layered") {
+            r.has_cycle = LayeredTopoSolver(g, workers).run_levels(r.levels);
+            r.order = r.levels.nodes;
+        } else if (algorithm == "lexi_min" || algorithm == "lexi_max") {
+            r.has_cycle = LexicographicKahnSolver(g, algorithm == "lexi_min").run(r.order);
+        } else {
+            throw std::invalid_argument("unknown algorithm: " + algorithm);
+        }
+        if (layout && !r.has_cycle) {
+            r.layout = make_layered_layout(g, r.order, layout->layer_gap, layout->radius_base, layout->radius_step);
+        }
+    }, hit);
+}
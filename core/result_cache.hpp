@@ -0,0 +1,128 @@
+#pragma once
+
+#include "compressed_graph.hpp"
+#include "layout.hpp"
+#include "parallel.hpp"
+#include "toposort.hpp"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Order and layout results keyed by (graph fingerprint, algorithm, layout parameters), so consumers that re-sort an
+// unchanged graph skip the solver and make_layered_layout. The fingerprint is CompressedGraph::fingerprint(): a 64-bit
+// hash of the node count and edge set (hash.hpp), not collision-proof against crafted graphs.
+// Entries live in memory up to max_bytes, least recently used first out. With a spill directory, evicted entries are
+// written there (one file each, checksummed) and a memory miss checks the directory before counting as a miss; files
+// are never deleted by the cache. Thread-safe; the lock is not held during solver runs or file I/O.
+
+struct CachedResult {
+    bool has_cycle{false};
+    std::vector<uint32_t> order;
+    TopoLevels levels;               // "layered" results only
+    std::vector<LayoutPoint> layout; // empty unless the key asked for one
+};
+
+struct LayoutParams {
+    float layer_gap{1.5f};
+    float radius_base{2.0f};
+    float radius_step{1.0f};
+};
+
+struct ResultKey {
+    uint64_t fingerprint{0};
+    std::string algorithm;
+    bool with_layout{false};
+    LayoutParams layout{}; // ignored unless with_layout
+
+    bool operator==(const ResultKey &o) const;
+    uint64_t hash() const;
+};
+
+struct ResultCacheOptions {
+    size_t max_bytes{size_t(256) << 20};
+    std::string spill_dir; // empty: memory only
+};
+
+struct ResultCacheStats {
+    uint64_t hits{0};      // served from memory
+    uint64_t disk_hits{0}; // served from the spill directory (and moved back into memory)
+    uint64_t misses{0};
+    uint64_t evictions{0};
+    uint64_t spilled{0};   // evictions written to the spill directory
+    size_t entries{0};
+    size_t bytes{0};
+};
+
+// Fingerprint of any graph: O(1) for a CompressedGraph, otherwise one parallel pass over a CSR view.
+uint64_t fingerprint_of(const GraphInterface &g);
+
+class ResultCache {
+public:
+    using ResultPtr = std::shared_ptr<const CachedResult>;
+
+    explicit ResultCache(ResultCacheOptions opt = {});
+    ResultCache(const ResultCache &) = delete;
+    ResultCache &operator=(const ResultCache &) = delete;
+
+    // nullptr on a miss.
+    ResultPtr lookup(const ResultKey &key);
+    void store(const ResultKey &key, ResultPtr result);
+
+    // Lookup, else compute(CachedResult &) and store; *hit tells which. Concurrent misses on one key may both compute.
+    template <class Compute>
+    ResultPtr get_or_compute(const ResultKey &key, Compute &&compute, bool *hit = nullptr) {
+        ResultPtr found = lookup(key);
+        if (hit) *hit = found != nullptr;
+        if (found) return found;
+        auto r = std::make_shared<CachedResult>();
+        compute(*r);
+        ResultPtr result = std::move(r);
+        store(key, result);
+        return result;
+    }
+
+    ResultCacheStats stats() const;
+    // Drops the in-memory entries (spilled files stay) and zeroes the counters.
+    void clear();
+
+private:
+    struct Entry {
+        ResultKey key;
+        ResultPtr result;
+        size_t bytes;
+        bool on_disk; // loaded from the spill directory, so eviction need not write it again
+    };
+    struct KeyHash {
+        size_t operator()(const ResultKey &k) const { return static_cast<size_t>(k.hash()); }
+    };
+    using EntryList = std::list<Entry>;
+
+    void insert_locked(const ResultKey &key, ResultPtr result, bool on_disk, std::vector<Entry> &evicted);
+    std::string spill_path(const ResultKey &key) const;
+    void spill(const std::vector<Entry> &evicted);
+
+    ResultCacheOptions opt_;
+    mutable SpinLock lock_;
+    EntryList lru_; // most recent first
+    std::unordered_map<ResultKey, EntryList::iterator, KeyHash> index_;
+    size_t bytes_{0};
+    ResultCacheStats stats_;
+};
+
+// Runs `algorithm` (dfs | kahn | parallel | layered | lexi_min | lexi_max) on g through the cache, with a layout when
+// layout is non-null (skipped on a cycle); *hit reports whether the solver was skipped. Throws std::invalid_argument on
+// an unknown algorithm. `workers` is the thread count for parallel and layered; callers that already run many solves
+// at once (the HTTP service) pass their share of the cores. The first form takes a fingerprint the caller already has
+// (e.g. of the CompressedGraph that g is a snapshot of).
+ResultCache::ResultPtr solve_cached(ResultCache &cache, GraphInterface &g, uint64_t fingerprint,
+                                    const std::string &algorithm, const LayoutParams *layout = nullptr,
+                                    bool *hit = nullptr, size_t workers = default_worker_count());
+inline ResultCache::ResultPtr solve_cached(ResultCache &cache, GraphInterface &g, const std::string &algorithm,
+                                           const LayoutParams *layout = nullptr, bool *hit = nullptr,
+                                           size_t workers = default_worker_count()) {
+    return solve_cached(cache, g, fingerprint_of(g), algorithm, layout, hit, workers);
+}
@@ -0,0 +1,329 @@
+#include "scc.hpp"
+#include "csr_builder.hpp"
+#include "topo_kernels.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace {
+using node_t = GraphInterface::node_t;
+
+constexpr uint32_t kUnset = UINT32_MAX;
+// Graphs smaller than this take the sequential path even when workers are offered.
+constexpr size_t kSccMinParallelNodes = 1u << 16;
+// Frontiers narrower than this are expanded on the calling thread.
+constexpr size_t kSccMinParallelFrontier = 4096;
+
+// Iterative Tarjan over the nodes accepted by keep. Every component gets the next label, in the order Tarjan closes
+// them, which is reverse topological. A visited node is on the Tarjan stack exactly while it has no label yet.
+template <class Graph, class Keep>
+uint32_t tarjan(const Graph &g, Keep &&keep, std::vector<uint32_t> &label, uint32_t next_label) {
+    size_t n = g.node_count();
+    std::vector<uint32_t> index(n, kUnset);
+    std::vector<uint32_t> low(n);
+    std::vector<kernels::DfsFrame> frames;
+    std::vector<node_t> stack;
+    uint32_t counter = 0;
+    for (node_t root = 0; root < n; ++root) {
+        if (index[root] != kUnset || !keep(root)) continue;
+        index[root] = low[root] = counter++;
+        stack.push_back(root);
+        frames.push_back(g.row_cursor(root));
+        while (!frames.empty()) {
+            kernels::DfsFrame &top = frames.back();
+            node_t v;
+            if (g.next_neighbor(top, v)) {
+                if (!keep(v)) continue;
+                if (index[v] == kUnset) {
+                    index[v] = low[v] = counter++;
+                    stack.push_back(v);
+                    frames.push_back(g.row_cursor(v));
+                } else if (label[v] == kUnset) {
+                    low[top.node] = std::min(low[top.node], index[v]);
+                }
+                continue;
+            }
+            node_t u = top.node;
+            frames.pop_back();
+            if (low[u] == index[u]) {
+                node_t w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    label[w] = next_label;
+                } while (w != u);
+                ++next_label;
+            }
+            if (!frames.empty()) {
+                node_t p = frames.back().node;
+                low[p] = std::min(low[p], low[u]);
+            }
+        }
+    }
+    return next_label;
+}
+
+// Fill offsets/members from component (counting sort, so members stay ascending).
+void group_members(SccResult &r, uint32_t count) {
+    r.offsets.assign(static_cast<size_t>(count) + 1, 0);
+    for (uint32_t c : r.component) r.offsets[c + 1]++;
+    for (uint32_t c = 0; c < count; ++c) r.offsets[c + 1] += r.offsets[c];
+    r.members.resize(r.component.size());
+    std::vector<uint32_t> cursor(r.offsets.begin(), r.offsets.end() - 1);
+    for (node_t u = 0; u < r.component.size(); ++u) r.members[cursor[r.component[u]]++] = u;
+}
+
+template <class Graph>
+SccResult tarjan_scc(const Graph &g) {
+    SccResult r;
+    r.component.assign(g.node_count(), kUnset);
+    uint32_t count = tarjan(g, [](node_t) { return true; }, r.component, 0);
+    for (uint32_t &c : r.component) c = count - 1 - c;
+    group_members(r, count);
+    return r;
+}
+
+// Level-synchronous sweep: expand(u, next) runs for every node of each frontier and appends newly reached nodes to
+// next, a per-worker buffer. Every frontier node is also appended to seen, level by level.
+template <class Expand>
+void sweep(std::vector<node_t> frontier, size_t workers, std::vector<node_t> &seen, Expand &&expand) {
+    std::vector<std::vector<node_t>> next(workers);
+    while (!frontier.empty()) {
+        seen.insert(seen.end(), frontier.begin(), frontier.end());
+        size_t w = frontier.size() >= kSccMinParallelFrontier ? workers : 1;
+        parallel_for(frontier.size(), w, [&](size_t id, size_t b, size_t e) {
+            for (size_t i = b; i < e; ++i) expand(frontier[i], next[id]);
+        });
+        frontier.clear();
+        for (auto &buf : next) {
+            frontier.insert(frontier.end(), buf.begin(), buf.end());
+            buf.clear();
+        }
+    }
+}
+
+template <class T>
+std::unique_ptr<std::atomic<T>[]> make_atomic_array(size_t n) {
+    std::unique_ptr<std::atomic<T>[]> a(new std::atomic<T>[n]);
+    for (size_t i = 0; i < n; ++i) a[i].store(0, std::memory_order_relaxed);
+    return a;
+}
+
+// Labels are arbitrary here; order them by a Kahn pass over the labelled condensation.
+SccResult renumber_topologically(const CsrView &g, std::vector<uint32_t> label, uint32_t count) {
+    SccResult grouped;
+    grouped.component = std::move(label);
+    group_members(grouped, count);
+
+    std::vector<uint32_t> indeg(count, 0);
+    for (node_t u = 0; u < g.node_count(); ++u) {
+        g.for_each_neighbor(u, [&](node_t v) {
+            if (grouped.component[v] != grouped.component[u]) indeg[grouped.component[v]]++;
+        });
+    }
+    std::vector<uint32_t> queue;
+    queue.reserve(count);
+    for (uint32_t c = 0; c < count; ++c) {
+        if (indeg[c] == 0) queue.push_back(c);
+    }
+    std::vector<uint32_t> rank(count);
+    for (size_t head = 0; head < queue.size(); ++head) {
+        uint32_t c = queue[head];
+        rank[c] = static_cast<uint32_t>(head);
+        for (uint32_t i = grouped.offsets[c]; i < grouped.offsets[c + 1]; ++i) {
+            g.for_each_neighbor(grouped.members[i], [&](node_t v) {
+                uint32_t cv = grouped.component[v];
+                if (cv != c && --indeg[cv] == 0) queue.push_back(cv);
+            });
+        }
+    }
+
+    SccResult r;
+    r.component = std::move(grouped.component);
+    for (uint32_t &c : r.component) c = rank[c];
+    group_members(r, count);
+    return r;
+}
+
+SccResult parallel_scc(const CsrView &g, size_t workers) {
+    size_t n = g.node_count();
+    const uint32_t *off = g.offsets();
+    const node_t *nbr = g.neighbors();
+
+    // Reverse CSR for the backward passes.
+    std::vector<std::pair<node_t, node_t>> rev(g.edge_count());
+    parallel_for(n, workers, [&](size_t, size_t b, size_t e) {
+        for (size_t u = b; u < e; ++u) {
+            for (uint32_t i = off[u]; i < off[u + 1]; ++i) rev[i] = {nbr[i], static_cast<node_t>(u)};
+        }
+    });
+    CsrData rdata;
+    build_csr_from_edges(n, rev, rdata, workers);
+    std::vector<std::pair<node_t, node_t>>().swap(rev);
+    const uint32_t *roff = rdata.offsets.data();
+    const node_t *rnbr = rdata.neighbors.data();
+
+    std::vector<uint32_t> label(n, kUnset);
+    uint32_t count = 0;
+    std::vector<uint8_t> live(n, 1);
+    std::vector<node_t> frontier;
+    std::vector<node_t> seen;
+
+    // Trim: a node with no live predecessor, or no live successor, is a component of its own. Peel sources level by
+    // level, then sinks of what remains.
+    auto degree = make_atomic_array<uint32_t>(n);
+    parallel_for(n, workers, [&](size_t, size_t b, size_t e) {
+        for (size_t u = b; u < e; ++u) degree[u].store(roff[u + 1] - roff[u], std::memory_order_relaxed);
+    });
+    for (node_t u = 0; u < n; ++u) {
+        if (roff[u + 1] == roff[u]) frontier.push_back(u);
+    }
+    sweep(std::move(frontier), workers, seen, [&](node_t u, std::vector<node_t> &next) {
+        for (uint32_t i = off[u]; i < off[u + 1]; ++i) {
+            if (degree[nbr[i]].fetch_sub(1, std::memory_order_relaxed) == 1) next.push_back(nbr[i]);
+        }
+    });
+    for (node_t u : seen) live[u] = 0, label[u] = count++;
+    seen.clear();
+
+    frontier.clear();
+    parallel_for(n, workers, [&](size_t, size_t b, size_t e) {
+        for (size_t u = b; u < e; ++u) {
+            uint32_t d = 0;
+            if (live[u]) {
+                for (uint32_t i = off[u]; i < off[u + 1]; ++i) d += live[nbr[i]];
+            }
+            degree[u].store(d, std::memory_order_relaxed);
+        }
+    });
+    for (node_t u = 0; u < n; ++u) {
+        if (live[u] && degree[u].load(std::memory_order_relaxed) == 0) frontier.push_back(u);
+    }
+    sweep(std::move(frontier), workers, seen, [&](node_t v, std::vector<node_t> &next) {
+        for (uint32_t i = roff[v]; i < roff[v + 1]; ++i) {
+            node_t u = rnbr[i];
+            if (live[u] && degree[u].fetch_sub(1, std::memory_order_relaxed) == 1) next.push_back(u);
+        }
+    });
+    for (node_t u : seen) live[u] = 0, label[u] = count++;
+    seen.clear();
+    degree.reset();
+
+    // Forward-backward from the live node with the largest degree product: the nodes reached both ways form its
+    // component, which on real graphs is usually the giant one. The backward pass stays inside the forward set.
+    node_t pivot = static_cast<node_t>(n);
+    uint64_t best = 0;
+    for (node_t u = 0; u < n; ++u) {
+        if (!live[u]) continue;
+        uint64_t score = uint64_t(off[u + 1] - off[u] + 1) * (roff[u + 1] - roff[u] + 1);
+        if (score > best) best = score, pivot = u;
+    }
+    if (pivot != n) {
+        auto mark = make_atomic_array<uint8_t>(n);
+        mark[pivot].store(3, std::memory_order_relaxed);
+        sweep({pivot}, workers, seen, [&](node_t u, std::vector<node_t> &next) {
+            for (uint32_t i = off[u]; i < off[u + 1]; ++i) {
+                node_t v = nbr[i];
+                if (live[v] && !(mark[v].fetch_or(1, std::memory_order_relaxed) & 1)) next.push_back(v);
+            }
+        });
+        seen.clear();
+        sweep({pivot}, workers, seen, [&](node_t v, std::vector<node_t> &next) {
+            for (uint32_t i = roff[v]; i < roff[v + 1]; ++i) {
+                node_t u = rnbr[i];
+                if ((mark[u].load(std::memory_order_relaxed) & 1) &&
+                    !(mark[u].fetch_or(2, std::memory_order_relaxed) & 2)) {
+                    next.push_back(u);
+                }
+            }
+        });
+        for (node_t u : seen) live[u] = 0, label[u] = count;
+        ++count;
+        seen.clear();
+    }
+
+    count = tarjan(g, [&](node_t u) { return live[u] != 0; }, label, count);
+    return renumber_topologically(g, std::move(label), count);
+}
+
+template <class Graph>
+bool shortest_cycle(const Graph &g, const SccResult &scc, std::vector<node_t> &cycle) {
+    cycle.clear();
+    std::vector<uint32_t> parent;
+    std::vector<node_t> queue;
+    for (uint32_t c = 0; c < scc.component_count(); ++c) {
+        node_t s = scc.members[scc.offsets[c]];
+        if (scc.size(c) == 1) {
+            bool loop = false;
+            g.for_each_neighbor(s, [&](node_t v) { loop |= v == s; });
+            if (!loop) continue;
+            cycle.push_back(s);
+            return true;
+        }
+        // BFS from s inside the component; the first node seen with an edge back to s closes a shortest cycle.
+        parent.assign(g.node_count(), kUnset);
+        parent[s] = s;
+        queue.assign(1, s);
+        for (size_t head = 0; head < queue.size(); ++head) {
+            node_t x = queue[head];
+            bool closes = false;
+            g.for_each_neighbor(x, [&](node_t v) {
+                if (v == s) closes = true;
+                if (closes || scc.component[v] != c || parent[v] != kUnset) return;
+                parent[v] = x;
+                queue.push_back(v);
+            });
+            if (!closes) continue;
+            for (node_t y = x; y != s; y = parent[y]) cycle.push_back(y);
+            cycle.push_back(s);
+            std::reverse(cycle.begin(), cycle.end());
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+SccResult strongly_connected_components(const GraphInterface &g, size_t workers) {
+    return visit_graph(g, [&](const auto &cg) {
+        if (workers > 1 && cg.node_count() >= kSccMinParallelNodes) return parallel_scc(kernels::to_csr(cg), workers);
+        return tarjan_scc(cg);
+    });
+}
+
+bool find_cycle(const GraphInterface &g, std::vector<node_t> &cycle) {
+    return find_cycle(g, strongly_connected_components(g), cycle);
+}
+
+bool find_cycle(const GraphInterface &g, const SccResult &scc, std::vector<node_t> &cycle) {
+    return visit_graph(g, [&](const auto &cg) { return shortest_cycle(cg, scc, cycle); });
+}
+
+Condensation::Condensation(const GraphInterface &g, size_t workers) : scc_(strongly_connected_components(g, workers)) {
+    uint32_t count = static_cast<uint32_t>(scc_.component_count());
+    CsrData csr;
+    csr.offsets.assign(static_cast<size_t>(count) + 1, 0);
+    visit_graph(g, [&](const auto &cg) {
+        for (uint32_t c = 0; c < count; ++c) {
+            for (uint32_t i = scc_.offsets[c]; i < scc_.offsets[c + 1]; ++i) {
+                cg.for_each_neighbor(scc_.members[i], [&](node_t v) {
+                    if (scc_.component[v] != c) csr.neighbors.push_back(scc_.component[v]);
+                });
+            }
+            csr.offsets[c + 1] = static_cast<uint32_t>(csr.neighbors.size());
+        }
+    });
+    sort_dedup_rows(csr, workers);
+    graph_.build_from_csr(std::move(csr));
+}
+
+void Condensation::expand(const std::vector<node_t> &order, std::vector<node_t> &nodes) const {
+    nodes.clear();
+    nodes.reserve(scc_.component.size());
+    for (node_t c : order) {
+        nodes.insert(nodes.end(), scc_.members.begin() + scc_.offsets[c], scc_.members.begin() + scc_.offsets[c + 1]);
+    }
+}
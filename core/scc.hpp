@@ -0,0 +1,50 @@
+#pragma once
+
+#include "compressed_graph.hpp"
+#include "parallel.hpp"
+
+#include <vector>
+
+// Strongly connected components, numbered in topological order of the condensation: every edge u->v has
+// component[u] <= component[v], with equality exactly when both ends are in one component.
+struct SccResult {
+    std::vector<uint32_t> component;             // per node
+    std::vector<uint32_t> offsets;               // component_count() + 1 entries
+    std::vector<GraphInterface::node_t> members; // component c is members[offsets[c] .. offsets[c + 1]), ascending
+
+    size_t component_count() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    uint32_t size(uint32_t c) const { return offsets[c + 1] - offsets[c]; }
+};
+
+// With one worker (or a small graph): iterative Tarjan, a single DFS over resumable row cursors, no recursion.
+// With more: nodes that cannot lie on a cycle are trimmed by peeling zero in- and out-degree nodes level by level, the
+// component of a high-degree pivot is found by forward-backward reachability (both level-synchronous parallel BFS,
+// the backward one over a reverse CSR), Tarjan handles what is left, and a Kahn pass over the condensation numbers the
+// components. Both paths find the same components; only their numbering may differ.
+// Time O(n+m), space O(n) (plus the reverse CSR in the parallel case).
+SccResult strongly_connected_components(const GraphInterface &g, size_t workers = 1);
+
+// Witness cycle: a shortest cycle through the smallest node of the lowest-numbered component that has one (more than
+// one node, or a self-loop). cycle lists its nodes in edge order; the edge from the last back to cycle[0] closes it.
+// Returns false, with cycle cleared, when g is a DAG.
+bool find_cycle(const GraphInterface &g, std::vector<GraphInterface::node_t> &cycle);
+// Same, reusing components already computed for g.
+bool find_cycle(const GraphInterface &g, const SccResult &scc, std::vector<GraphInterface::node_t> &cycle);
+
+// Condensation DAG of a graph: one node per component and one edge per pair of components joined by an edge of g.
+// Its ids are already a topological order, and any solver can run on graph(); expand() maps a component order back
+// to the original nodes.
+class Condensation {
+public:
+    explicit Condensation(const GraphInterface &g, size_t workers = 1);
+
+    CompressedGraph &graph() { return graph_; }
+    const SccResult &scc() const { return scc_; }
+    // Members of each component in `order`, in turn. A topological order of the condensation gives an order of g in
+    // which only edges inside a component point backwards (none when g is a DAG).
+    void expand(const std::vector<GraphInterface::node_t> &order, std::vector<GraphInterface::node_t> &nodes) const;
+
+private:
+    SccResult scc_;
+    CompressedGraph graph_;
+};
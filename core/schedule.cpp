@@ -0,0 +1,212 @@
+#include "schedule.hpp"
+#include "toposort.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+using node_t = GraphInterface::node_t;
+
+// Levels narrower than this are walked on the calling thread; starting the pool costs more than it saves.
+constexpr size_t kScheduleMinParallelWidth = 16384;
+
+void check_weights(const GraphInterface &g, const std::vector<uint32_t> &weight) {
+    if (!weight.empty() && weight.size() != g.node_count()) {
+        throw std::invalid_argument("weight count must match node_count");
+    }
+}
+
+// Run fn(i) for every i in [begin, end), split across workers when the range is wide.
+template <class Fn>
+void for_level(size_t begin, size_t end, size_t workers, Fn &&fn) {
+    if (workers <= 1 || end - begin < kScheduleMinParallelWidth) {
+        for (size_t i = begin; i < end; ++i) fn(i);
+        return;
+    }
+    parallel_for(end - begin, workers, [&](size_t, size_t b, size_t e) {
+        for (size_t i = begin + b; i < begin + e; ++i) fn(i);
+    });
+}
+
+template <class Graph>
+void critical_path_passes(const Graph &g, const TopoLevels &levels, const std::vector<uint32_t> &weight,
+                          size_t workers, CriticalPathResult &r) {
+    size_t n = g.node_count();
+    auto w = [&](node_t u) -> uint64_t { return weight.empty() ? 1 : weight[u]; };
+
+    std::unique_ptr<std::atomic<uint64_t>[]> es(new std::atomic<uint64_t>[n]);
+    for (size_t u = 0; u < n; ++u) es[u].store(0, std::memory_order_relaxed);
+    for (size_t k = 0; k < levels.level_count(); ++k) {
+        for_level(levels.offsets[k], levels.offsets[k + 1], workers, [&](size_t i) {
+            node_t u = levels.nodes[i];
+            uint64_t finish = es[u].load(std::memory_order_relaxed) + w(u);
+            g.for_each_neighbor(u, [&](node_t v) {
+                uint64_t cur = es[v].load(std::memory_order_relaxed);
+                while (cur < finish && !es[v].compare_exchange_weak(cur, finish, std::memory_order_relaxed)) {}
+            });
+        });
+    }
+    r.earliest_start.resize(n);
+    r.makespan = 0;
+    for (node_t u = 0; u < n; ++u) {
+        r.earliest_start[u] = es[u].load(std::memory_order_relaxed);
+        r.makespan = std::max(r.makespan, r.earliest_start[u] + w(u));
+    }
+    es.reset();
+
+    // Each node writes only its own entry and reads entries of later levels, so no atomics are needed here.
+    r.latest_start.assign(n, 0);
+    for (size_t k = levels.level_count(); k-- > 0;) {
+        for_level(levels.offsets[k], levels.offsets[k + 1], workers, [&](size_t i) {
+            node_t u = levels.nodes[i];
+            uint64_t finish = r.makespan;
+            g.for_each_neighbor(u, [&](node_t v) { finish = std::min(finish, r.latest_start[v]); });
+            r.latest_start[u] = finish - w(u);
+        });
+    }
+
+    // Walk one chain of tight zero-slack edges from the smallest-id critical source.
+    r.critical_path.clear();
+    node_t cur = static_cast<node_t>(n);
+    for (node_t u = 0; u < n && cur == n; ++u) {
+        if (r.earliest_start[u] == 0 && r.latest_start[u] == 0) cur = u;
+    }
+    while (cur != n) {
+        r.critical_path.push_back(cur);
+        uint64_t finish = r.earliest_start[cur] + w(cur);
+        node_t next = static_cast<node_t>(n);
+        g.for_each_neighbor(cur, [&](node_t v) {
+            if (v < next && r.earliest_start[v] == finish && r.latest_start[v] == finish) next = v;
+        });
+        cur = next;
+    }
+}
+
+template <class Graph>
+void simulate(const Graph &g, const std::vector<uint32_t> &weight, size_t processors,
+              const std::vector<uint64_t> &priority, ScheduleResult &r) {
+    size_t n = g.node_count();
+    auto w = [&](node_t u) -> uint64_t { return weight.empty() ? 1 : weight[u]; };
+    std::vector<uint32_t> indeg;
+    kernels::indegrees(g, indeg);
+
+    // Ready tasks by (priority desc, id asc); kFifo passes an empty priority and uses the ready sequence instead.
+    using Ready = std::pair<uint64_t, node_t>;
+    auto ready_less = [](const Ready &a, const Ready &b) {
+        return a.first < b.first || (a.first == b.first && a.second > b.second);
+    };
+    std::priority_queue<Ready, std::vector<Ready>, decltype(ready_less)> ready(ready_less);
+    uint64_t seq = 0;
+    auto make_ready = [&](node_t u) {
+        ready.emplace(priority.empty() ? UINT64_MAX - seq++ : priority[u], u);
+    };
+
+    // Running tasks by finish time; ties release the lower worker first so the result is deterministic.
+    using Running = std::tuple<uint64_t, uint32_t, node_t>;
+    std::priority_queue<Running, std::vector<Running>, std::greater<Running>> running;
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> idle; // lowest free worker first
+    for (size_t p = 0; p < processors; ++p) idle.push(static_cast<uint32_t>(p));
+
+    r.start.assign(n, 0);
+    r.worker.assign(n, UINT32_MAX);
+    std::vector<node_t> dispatched;
+    dispatched.reserve(n);
+    for (node_t u = 0; u < n; ++u) if (indeg[u] == 0) make_ready(u);
+
+    uint64_t now = 0;
+    for (;;) {
+        while (!ready.empty() && !idle.empty()) {
+            node_t u = ready.top().second;
+            ready.pop();
+            uint32_t p = idle.top();
+            idle.pop();
+            r.start[u] = now;
+            r.worker[u] = p;
+            dispatched.push_back(u);
+            running.emplace(now + w(u), p, u);
+        }
+        if (running.empty()) break;
+        now = std::get<0>(running.top());
+        while (!running.empty() && std::get<0>(running.top()) == now) {
+            uint32_t p = std::get<1>(running.top());
+            node_t u = std::get<2>(running.top());
+            running.pop();
+            idle.push(p);
+            g.for_each_neighbor(u, [&](node_t v) {
+                if (--indeg[v] == 0) make_ready(v);
+            });
+        }
+    }
+    r.makespan = now;
+    r.has_cycle = dispatched.size() != n;
+
+    r.worker_offsets.assign(processors + 1, 0);
+    for (node_t u : dispatched) r.worker_offsets[r.worker[u] + 1]++;
+    for (size_t p = 0; p < processors; ++p) r.worker_offsets[p + 1] += r.worker_offsets[p];
+    r.worker_tasks.resize(dispatched.size());
+    std::vector<uint32_t> cursor(r.worker_offsets.begin(), r.worker_offsets.end() - 1);
+    for (node_t u : dispatched) r.worker_tasks[cursor[r.worker[u]]++] = u; // dispatch order is start order
+}
+}
+
+CriticalPathResult critical_path(const GraphInterface &g, const std::vector<uint32_t> &weight, size_t workers) {
+    check_weights(g, weight);
+    CriticalPathResult r;
+    TopoLevels levels;
+    // Solvers hold a non-const reference for historical reasons; LayeredTopoSolver only reads the graph.
+    if (LayeredTopoSolver(const_cast<GraphInterface &>(g), workers).run_levels(levels)) {
+        r.has_cycle = true;
+        return r;
+    }
+    visit_graph(g, [&](const auto &cg) { critical_path_passes(cg, levels, weight, std::max<size_t>(1, workers), r); });
+    return r;
+}
+
+const char *priority_rule_name(PriorityRule r) {
+    switch (r) {
+    case PriorityRule::kLongestPath: return "longest_path";
+    case PriorityRule::kLongestTask: return "longest_task";
+    case PriorityRule::kFifo: return "fifo";
+    }
+    return "unknown";
+}
+
+bool parse_priority_rule(const std::string &name, PriorityRule &out) {
+    for (PriorityRule r : {PriorityRule::kLongestPath, PriorityRule::kLongestTask, PriorityRule::kFifo}) {
+        if (name == priority_rule_name(r)) {
+            out = r;
+            return true;
+        }
+    }
+    return false;
+}
+
+ScheduleResult list_schedule(const GraphInterface &g, const std::vector<uint32_t> &weight, size_t processors,
+                             PriorityRule rule) {
+    check_weights(g, weight);
+    processors = std::max<size_t>(1, processors);
+    std::vector<uint64_t> priority;
+    if (rule == PriorityRule::kLongestPath) {
+        CriticalPathResult cp = critical_path(g, weight);
+        if (!cp.has_cycle) {
+            // Remaining path from u through a sink is makespan - latest_start[u].
+            priority.resize(g.node_count());
+            for (size_t u = 0; u < priority.size(); ++u) priority[u] = cp.makespan - cp.latest_start[u];
+        } else {
+            // No path lengths on a cycle; schedule the acyclic part by own weight so the result has the same shape
+            // as under the other rules.
+            rule = PriorityRule::kLongestTask;
+        }
+    }
+    if (rule == PriorityRule::kLongestTask) {
+        priority.assign(g.node_count(), 1);
+        for (size_t u = 0; u < weight.size(); ++u) priority[u] = weight[u];
+    }
+    ScheduleResult r;
+    visit_graph(g, [&](const auto &cg) { simulate(cg, weight, processors, priority, r); });
+    return r;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "compressed_graph.hpp"
+#include "parallel.hpp"
+
+#include <string>
+#include <vector>
+
+// Timing analysis of a task DAG in which node u takes weight[u] time units and starts once all of its predecessors
+// have finished (critical path method). An empty weight vector means every task takes 1.
+struct CriticalPathResult {
+    bool has_cycle{false};
+    uint64_t makespan{0};                              // length of the longest weighted chain
+    std::vector<uint64_t> earliest_start;
+    std::vector<uint64_t> latest_start;                // latest start that does not delay makespan
+    std::vector<GraphInterface::node_t> critical_path; // one zero-slack chain, source to sink
+
+    uint64_t slack(GraphInterface::node_t u) const { return latest_start[u] - earliest_start[u]; }
+};
+
+// One pass each way over the levels of LayeredTopoSolver: earliest starts are pushed along out-edges level by level,
+// latest starts pulled from successors from the last level back, so no reverse graph is built. Levels wider than a
+// few thousand nodes are split across `workers` threads (the forward pass then combines with an atomic max).
+// Throws std::invalid_argument if weight is neither empty nor node_count() long. On a cycle only has_cycle is set.
+// Time O(n+m) (O((n+m)/p + L) in parallel), space O(n).
+CriticalPathResult critical_path(const GraphInterface &g, const std::vector<uint32_t> &weight,
+                                 size_t workers = default_worker_count());
+
+// Which ready task an idle worker takes next; ties go to the smallest id.
+enum class PriorityRule {
+    kLongestPath, // largest remaining weighted path to a sink, the task's own weight included (HLFET)
+    kLongestTask, // largest own weight
+    kFifo,        // earliest to become ready
+};
+
+const char *priority_rule_name(PriorityRule r);
+bool parse_priority_rule(const std::string &name, PriorityRule &out);
+
+// Result of list_schedule. Assignments are a CSR in start order: worker w ran
+// worker_tasks[worker_offsets[w] .. worker_offsets[w + 1]).
+struct ScheduleResult {
+    bool has_cycle{false};
+    uint64_t makespan{0};
+    std::vector<uint64_t> start;  // per task
+    std::vector<uint32_t> worker; // per task
+    std::vector<uint32_t> worker_offsets;
+    std::vector<GraphInterface::node_t> worker_tasks;
+};
+
+// Non-preemptive list scheduling on `processors` identical workers, simulated event by event: whenever workers are
+// idle they take the ready tasks with the highest priority. Weights as for critical_path. On a cycle the tasks that
+// never became ready are left unscheduled (start 0, worker UINT32_MAX, in no worker's list) and has_cycle is set;
+// start and worker still have n entries and worker_offsets processors + 1 under every rule. kLongestPath has no path
+// lengths on a cycle and falls back to kLongestTask priorities. Time O((n+m) log n), space O(n).
+ScheduleResult list_schedule(const GraphInterface &g, const std::vector<uint32_t> &weight, size_t processors,
+                             PriorityRule rule);
@@ -0,0 +1,347 @@
+#include "text_parser.hpp"
+#include "csr_builder.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+using node_t = GraphInterface::node_t;
+
+// Chunks smaller than this are not worth a thread.
+constexpr size_t kMinChunkBytes = 1u << 20;
+// Neighbor ids below this are range-checked on the calling thread; small bodies (every HTTP /sort) never spawn.
+constexpr size_t kParallelCheckIds = 1u << 16;
+constexpr size_t kStdinChunk = 1u << 20;
+constexpr uint64_t kBadValue = UINT64_MAX;
+
+inline bool is_space(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v'; }
+
+// Parse one integer at p (no leading whitespace). Negative or > UINT32_MAX values come back as kBadValue; a
+// non-numeric byte sets p to nullptr.
+inline uint64_t parse_token(const char *&p, const char *end) {
+    bool neg = false;
+    if (*p == '-' || *p == '+') {
+        neg = *p == '-';
+        ++p;
+    }
+    const char *start = p;
+    uint64_t v = 0;
+    while (p < end && static_cast<unsigned>(*p - '0') <= 9) {
+        if (v <= UINT32_MAX) v = v * 10 + static_cast<unsigned>(*p - '0');
+        ++p;
+    }
+    if (p == start || (p < end && !is_space(*p))) {
+        p = nullptr;
+        return kBadValue;
+    }
+    if (neg && v != 0) return kBadValue;
+    return v > UINT32_MAX ? kBadValue : v;
+}
+
+struct Chunk {
+    const char *begin;
+    const char *end;
+    size_t first_token{0}; // global index of the first token in this chunk
+    size_t tokens{0};
+    const char *syntax_error{nullptr};
+};
+
+std::vector<Chunk> split_chunks(const char *begin, const char *end, size_t workers) {
+    size_t bytes = static_cast<size_t>(end - begin);
+    size_t parts = std::max<size_t>(1, std::min(workers, bytes / kMinChunkBytes));
+    std::vector<Chunk> chunks;
+    const char *cur = begin;
+    for (size_t k = 1; k <= parts; ++k) {
+        const char *cut = k == parts ? end : begin + bytes * k / parts;
+        if (cut < cur) cut = cur;
+        while (cut < end && !is_space(*cut)) ++cut; // never split a token
+        chunks.push_back(Chunk{cur, cut});
+        cur = cut;
+    }
+    return chunks;
+}
+
+size_t count_tokens(const char *p, const char *end) {
+    size_t count = 0;
+    bool in_token = false;
+    for (; p < end; ++p) {
+        bool sp = is_space(*p);
+        count += (!sp && !in_token);
+        in_token = !sp;
+    }
+    return count;
+}
+
+// Walk the tokens of one chunk, calling sink(global_index, value). Values outside [0, UINT32_MAX) arrive as
+// UINT32_MAX, which every later range check (< n, <= list size) rejects. Records the first syntax error.
+template <class Sink>
+void scan_chunk(Chunk &c, Sink &&sink) {
+    const char *p = c.begin;
+    size_t idx = c.first_token;
+    while (true) {
+        while (p < c.end && is_space(*p)) ++p;
+        if (p >= c.end) break;
+        const char *at = p;
+        uint64_t v = parse_token(p, c.end);
+        if (!p) {
+            c.syntax_error = at;
+            return;
+        }
+        if (v == kBadValue) v = UINT32_MAX;
+        sink(idx++, static_cast<uint32_t>(v));
+    }
+}
+
+bool read_header(const char *&p, const char *end, int &n, int &m, std::string &err) {
+    long long vals[2];
+    for (auto &v : vals) {
+        while (p < end && is_space(*p)) ++p;
+        bool neg = p < end && *p == '-';
+        if (neg) ++p;
+        if (p >= end || static_cast<unsigned>(*p - '0') > 9) {
+            err = "failed to read n m";
+            return false;
+        }
+        long long x = 0;
+        while (p < end && static_cast<unsigned>(*p - '0') <= 9) {
+            if (x <= INT32_MAX) x = x * 10 + (*p - '0');
+            ++p;
+        }
+        if (x > INT32_MAX) {
+            err = "failed to read n m";
+            return false;
+        }
+        v = neg ? -x : x;
+    }
+    if (vals[0] < 0 || vals[1] < 0) {
+        err = "n and m must be non-negative";
+        return false;
+    }
+    n = static_cast<int>(vals[0]);
+    m = static_cast<int>(vals[1]);
+    return true;
+}
+
+uint64_t token_at(const std::vector<Chunk> &chunks, size_t index) {
+    for (const auto &c : chunks) {
+        if (index >= c.first_token + c.tokens) continue;
+        const char *p = c.begin;
+        for (size_t i = c.first_token;; ++i) {
+            while (is_space(*p)) ++p;
+            uint64_t v = parse_token(p, c.end);
+            if (!p || i == index) return v;
+        }
+    }
+    return kBadValue;
+}
+}
+
+InputBuffer::~InputBuffer() { release(); }
+
+void InputBuffer::release() {
+#if !defined(_WIN32)
+    if (mapped_ && data_) munmap(const_cast<char *>(data_), size_);
+#endif
+    mapped_ = false;
+    data_ = nullptr;
+    size_ = 0;
+    owned_.clear();
+}
+
+bool InputBuffer::open_file(const std::string &path, std::string &err) {
+    release();
+#if !defined(_WIN32)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        err = "cannot open " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        err = "cannot stat " + path;
+        return false;
+    }
+    if (st.st_size == 0) {
+        ::close(fd);
+        return true;
+    }
+    void *p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        err = "mmap failed for " + path;
+        return false;
+    }
+    madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+    data_ = static_cast<const char *>(p);
+    size_ = static_cast<size_t>(st.st_size);
+    mapped_ = true;
+    return true;
+#else
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        err = "cannot open " + path;
+        return false;
+    }
+    bool ok = read_stream(f, err);
+    std::fclose(f);
+    return ok;
+#endif
+}
+
+bool InputBuffer::read_stream(std::FILE *f, std::string &err) {
+    release();
+    for (;;) {
+        size_t old = owned_.size();
+        owned_.resize(old + kStdinChunk);
+        size_t got = std::fread(owned_.data() + old, 1, kStdinChunk, f);
+        owned_.resize(old + got);
+        if (got < kStdinChunk) break;
+    }
+    if (std::ferror(f)) {
+        err = "read error";
+        return false;
+    }
+    data_ = owned_.data();
+    size_ = owned_.size();
+    return true;
+}
+
+bool read_graph_header(const char *data, size_t size, size_t &n, size_t &m, std::string &err) {
+    const char *p = data;
+    int hn = 0, hm = 0;
+    if (!read_header(p, data + size, hn, hm, err)) return false;
+    n = static_cast<size_t>(hn);
+    m = static_cast<size_t>(hm);
+    return true;
+}
+
+bool parse_graph_text(const char *data, size_t size, CsrData &out, std::string &err, size_t workers) {
+    const char *p = data;
+    const char *end = data + size;
+    int n = 0, m = 0;
+    if (!read_header(p, end, n, m, err)) return false;
+    if (p < end && !is_space(*p)) {
+        err = "failed to read n m";
+        return false;
+    }
+
+    // Pass 1: token counts give every chunk its global token offset.
+    std::vector<Chunk> chunks = split_chunks(p, end, workers);
+    run_workers(chunks.size(), [&](size_t w) { chunks[w].tokens = count_tokens(chunks[w].begin, chunks[w].end); });
+    size_t total = 0;
+    for (auto &c : chunks) {
+        c.first_token = total;
+        total += c.tokens;
+    }
+
+    const size_t un = static_cast<size_t>(n);
+    bool csr = false;
+    if (total >= un + 1) {
+        uint64_t list_size = token_at(chunks, un);
+        csr = list_size != kBadValue && list_size == total - (un + 1);
+    }
+    if (!csr && total != 2 * static_cast<size_t>(m)) {
+        err = "unrecognized input format";
+        return false;
+    }
+
+    auto first_syntax_error = [&]() -> bool {
+        for (const auto &c : chunks) {
+            if (c.syntax_error) {
+                std::stringstream ss;
+                ss << "unexpected character at byte " << (c.syntax_error - data);
+                err = ss.str();
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Pass 2: convert each token straight into its destination.
+    if (csr) {
+        const size_t list_size = total - (un + 1);
+        CsrData csr_data;
+        csr_data.offsets.resize(un + 1);
+        csr_data.neighbors.resize(list_size);
+        uint32_t *offsets = csr_data.offsets.data();
+        uint32_t *neighbors = csr_data.neighbors.data();
+        run_workers(chunks.size(), [&](size_t w) {
+            scan_chunk(chunks[w], [&](size_t idx, uint32_t v) {
+                if (idx <= un) offsets[idx] = v;
+                else neighbors[idx - un - 1] = v;
+            });
+        });
+        if (first_syntax_error()) return false;
+
+        // Errors are reported in row order like the original row-by-row loader: the first row with bad offsets, unless
+        // an earlier (well-formed) row holds an out-of-range neighbor.
+        size_t bad_row = un;
+        for (size_t u = 0; u < un; ++u) {
+            if (offsets[u] > offsets[u + 1] || offsets[u + 1] > list_size) {
+                bad_row = u;
+                break;
+            }
+        }
+        size_t lo = un == 0 || bad_row == 0 ? 0 : offsets[0];
+        size_t hi = un == 0 || bad_row == 0 ? 0 : offsets[bad_row];
+        size_t check_workers = hi - lo < kParallelCheckIds ? 1 : std::max<size_t>(1, workers);
+        std::vector<size_t> worker_oob(check_workers, SIZE_MAX);
+        parallel_for(hi - lo, check_workers, [&](size_t w, size_t b, size_t e) {
+            for (size_t i = lo + b; i < lo + e; ++i) {
+                if (neighbors[i] >= un) {
+                    worker_oob[w] = i;
+                    break;
+                }
+            }
+        });
+        size_t first_oob = *std::min_element(worker_oob.begin(), worker_oob.end());
+        if (first_oob != SIZE_MAX) {
+            size_t u = static_cast<size_t>(std::upper_bound(offsets, offsets + bad_row + 1, first_oob) - offsets) - 1;
+            std::stringstream ss;
+            ss << "neighbor out of range at node " << u;
+            err = ss.str();
+            return false;
+        }
+        if (bad_row != un) {
+            err = "invalid CSR offsets";
+            return false;
+        }
+        if (lo != 0 || hi != list_size) {
+            // Entries outside [h[0], h[n]) belong to no row; drop them so offsets start at 0.
+            csr_data.neighbors.resize(hi);
+            csr_data.neighbors.erase(csr_data.neighbors.begin(), csr_data.neighbors.begin() + static_cast<std::ptrdiff_t>(lo));
+            for (auto &o : csr_data.offsets) o -= static_cast<uint32_t>(lo);
+            if (un == 0) csr_data.offsets[0] = 0;
+        }
+        sort_dedup_rows(csr_data, workers);
+        out = std::move(csr_data);
+        return true;
+    }
+
+    std::vector<std::pair<node_t, node_t>> edges(static_cast<size_t>(m));
+    run_workers(chunks.size(), [&](size_t w) {
+        scan_chunk(chunks[w], [&](size_t idx, uint32_t v) {
+            if (idx & 1) edges[idx >> 1].second = v;
+            else edges[idx >> 1].first = v;
+        });
+    });
+    if (first_syntax_error()) return false;
+    try {
+        build_csr_from_edges(un, edges, out, workers);
+    } catch (const std::out_of_range &) {
+        err = "edge endpoint out of range";
+        return false;
+    }
+    return true;
+}
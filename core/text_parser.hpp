@@ -0,0 +1,45 @@
+#pragma once
+
+#include "compressed_graph.hpp"
+#include "parallel.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Read-only byte buffer over graph text: a memory-mapped file (POSIX) or stdin slurped in fixed-size chunks.
+// Parsing works on the raw bytes; nothing is copied into std::string or a token vector.
+class InputBuffer {
+public:
+    InputBuffer() = default;
+    ~InputBuffer();
+    InputBuffer(const InputBuffer &) = delete;
+    InputBuffer &operator=(const InputBuffer &) = delete;
+
+    bool open_file(const std::string &path, std::string &err);
+    bool read_stream(std::FILE *f, std::string &err);
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void release();
+
+    const char *data_{nullptr};
+    size_t size_{0};
+    bool mapped_{false};
+    std::vector<char> owned_{};
+};
+
+// Parse "n m" followed by either a compressed CSR (h[0..n] then list, h[n] == list size) or m edge pairs "u v".
+// Same format rules and error strings as the original token-vector loader, except that a non-numeric byte is reported
+// ("unexpected character at byte N") instead of silently ending the input. The body is split into whitespace-aligned
+// chunks that are scanned in parallel twice: once to count tokens (which fixes every token's global index and
+// decides the format from the token count and h[n]), then to convert and store each integer straight into its final
+// slot: offsets/neighbors for CSR input, an edge array handed to build_csr_from_edges for edge lists.
+// Output rows are sorted and deduplicated.
+bool parse_graph_text(const char *data, size_t size, CsrData &out, std::string &err,
+                      size_t workers = default_worker_count());
+// Just the "n m" header, so a caller can bound n (the parser allocates n-sized arrays) before parsing the body.
+bool read_graph_header(const char *data, size_t size, size_t &n, size_t &m, std::string &err);
@@ -0,0 +1,293 @@
+#pragma once
+
+#include "binary_format.hpp"
+#include "compressed_graph.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+
+// Statically-dispatched solver bodies. `Graph` needs node_count(), for_each_neighbor(u, fn) and, for DFS,
+// row_cursor/next_neighbor (GraphInterface provides all of them). Instantiating on a final concrete type (CsrView,
+// VarintView) removes the per-node vtable call and lets the edge loops inline; none of the kernels hold a
+// neighbor_span across rows, so decode-on-the-fly storage works too.
+// Solver kernels count scanned edges in a local and publish the total once (instrument.hpp).
+// The virtual solver classes in toposort.hpp route through visit_graph() to reach these.
+namespace kernels {
+
+using node_t = GraphInterface::node_t;
+
+template <class Graph>
+void indegrees(const Graph &g, std::vector<uint32_t> &indeg) {
+    size_t n = g.node_count();
+    indeg.assign(n, 0);
+    for (node_t u = 0; u < n; ++u) g.for_each_neighbor(u, [&](node_t v) { indeg[v]++; });
+}
+
+// FIFO Kahn using `order` itself as the queue. Consumes `indeg`. Returns true on cycle.
+template <class Graph>
+bool kahn(const Graph &g, std::vector<uint32_t> &indeg, std::vector<node_t> &order) {
+    size_t n = g.node_count();
+    order.clear();
+    order.reserve(n);
+    for (node_t u = 0; u < n; ++u) if (indeg[u] == 0) order.push_back(u);
+    size_t scanned = 0;
+    for (size_t head = 0; head < order.size(); ++head) {
+        g.for_each_neighbor(order[head], [&](node_t v) {
+            ++scanned;
+            if (--indeg[v] == 0) order.push_back(v);
+        });
+    }
+    TOPSORT_COUNT(kEdgesScanned, scanned);
+    return order.size() != n;
+}
+
+// FIFO Kahn that also records level boundaries. A node is appended when its last predecessor is dequeued, and by
+// induction the queue is sorted by level, so levels are contiguous runs of `order`: level k is
+// order[level_offsets[k] .. level_offsets[k + 1]). Consumes `indeg`. Returns true on cycle.
+template <class Graph>
+bool kahn_levels(const Graph &g, std::vector<uint32_t> &indeg, std::vector<node_t> &order,
+                 std::vector<uint32_t> &level_offsets) {
+    size_t n = g.node_count();
+    order.clear();
+    order.reserve(n);
+    level_offsets.assign(1, 0);
+    for (node_t u = 0; u < n; ++u) if (indeg[u] == 0) order.push_back(u);
+    size_t level_end = order.size();
+    size_t scanned = 0;
+    for (size_t head = 0; head < order.size(); ++head) {
+        g.for_each_neighbor(order[head], [&](node_t v) {
+            ++scanned;
+            if (--indeg[v] == 0) order.push_back(v);
+        });
+        if (head + 1 == level_end) {
+            TOPSORT_LEVEL(level_end - level_offsets.back());
+            level_offsets.push_back(static_cast<uint32_t>(level_end));
+            level_end = order.size();
+        }
+    }
+    TOPSORT_COUNT(kEdgesScanned, scanned);
+    return order.size() != n;
+}
+
+// Kahn with a heap frontier; Cmp = std::greater pops the smallest id first (lexi_min), std::less the largest. The
+// reference for bitset_lexicographic_kahn below, which the solver uses.
+template <class Cmp, class Graph>
+bool lexicographic_kahn(const Graph &g, std::vector<uint32_t> &indeg, std::vector<node_t> &order) {
+    size_t n = g.node_count();
+    std::priority_queue<node_t, std::vector<node_t>, Cmp> pq;
+    for (node_t u = 0; u < n; ++u) if (indeg[u] == 0) pq.push(u);
+    order.clear();
+    order.reserve(n);
+    while (!pq.empty()) {
+        node_t u = pq.top();
+        pq.pop();
+        order.push_back(u);
+        g.for_each_neighbor(u, [&](node_t v) {
+            if (--indeg[v] == 0) pq.push(v);
+        });
+    }
+    return order.size() != n;
+}
+
+// Index of the lowest / highest set bit of a nonzero word.
+inline unsigned lowest_bit(uint64_t w) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(w));
+#else
+    unsigned i = 0;
+    while ((w & 1u) == 0) {
+        w >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+inline unsigned highest_bit(uint64_t w) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63u - static_cast<unsigned>(__builtin_clzll(w));
+#else
+    unsigned i = 63;
+    while ((w >> i) == 0) --i;
+    return i;
+#endif
+}
+
+// Set of node ids as a 64-ary bit tree: level 0 has one bit per node and each level above has one bit per nonzero
+// word below it, up to a single top word. All levels share one array (top level last). pop_min()/pop_max() walk down
+// from the top with one ctz/clz per level and clear bits on the way back up; insert touches one word per level and
+// stops at the first word that was already nonempty. O(log64 n) per operation (at most 6 levels for 32-bit ids) in
+// about n/8 bytes, so the hot words stay in cache.
+class ReadySet {
+public:
+    explicit ReadySet(size_t n) {
+        size_t bits = std::max<size_t>(n, 1), total = 0;
+        do {
+            bits = (bits + 63) / 64;
+            base_[levels_++] = total;
+            total += bits;
+        } while (bits > 1);
+        words_.assign(total, 0);
+    }
+    bool empty() const { return words_.back() == 0; }
+    void insert(node_t x) {
+        size_t i = x;
+        for (unsigned l = 0; l < levels_; ++l) {
+            uint64_t &w = words_[base_[l] + (i >> 6)];
+            bool was_empty = w == 0;
+            w |= uint64_t{1} << (i & 63);
+            if (!was_empty) return;
+            i >>= 6;
+        }
+    }
+    // Both require !empty().
+    node_t pop_min() { return pop<true>(); }
+    node_t pop_max() { return pop<false>(); }
+
+private:
+    static constexpr unsigned kMaxLevels = 7; // ceil(log64 2^32) + 1 for the n <= 64 case
+
+    template <bool Min>
+    node_t pop() {
+        size_t i = 0;
+        for (unsigned l = levels_; l-- > 0;) {
+            uint64_t w = words_[base_[l] + i];
+            i = (i << 6) | (Min ? lowest_bit(w) : highest_bit(w));
+        }
+        size_t x = i;
+        for (unsigned l = 0; l < levels_; ++l) {
+            uint64_t &w = words_[base_[l] + (i >> 6)];
+            w &= ~(uint64_t{1} << (i & 63));
+            if (w != 0) break;
+            i >>= 6;
+        }
+        return static_cast<node_t>(x);
+    }
+
+    std::vector<uint64_t> words_;
+    size_t base_[kMaxLevels]{};
+    unsigned levels_{0};
+};
+
+// Same order as lexicographic_kahn (the ready node with the smallest, or largest, id goes next) with a ReadySet
+// frontier instead of a heap: O(n log64 n + m) and no per-push allocation or sift.
+template <bool MinFirst, class Graph>
+bool bitset_lexicographic_kahn(const Graph &g, std::vector<uint32_t> &indeg, std::vector<node_t> &order) {
+    size_t n = g.node_count();
+    ReadySet ready(n);
+    for (node_t u = 0; u < n; ++u) if (indeg[u] == 0) ready.insert(u);
+    order.clear();
+    order.reserve(n);
+    size_t scanned = 0;
+    while (!ready.empty()) {
+        node_t u = MinFirst ? ready.pop_min() : ready.pop_max();
+        order.push_back(u);
+        g.for_each_neighbor(u, [&](node_t v) {
+            ++scanned;
+            if (--indeg[v] == 0) ready.insert(v);
+        });
+    }
+    TOPSORT_COUNT(kEdgesScanned, scanned);
+    return order.size() != n;
+}
+
+// A DFS frame is the node plus its resumable neighbor cursor.
+using DfsFrame = GraphInterface::RowCursor;
+
+// Iterative three-color DFS; reverse postorder. Returns true on the first back edge.
+template <class Graph>
+bool dfs(const Graph &g, std::vector<DfsFrame> &stack, std::vector<uint8_t> &state, std::vector<node_t> &order) {
+    size_t n = g.node_count();
+    state.assign(n, 0); // 0=unseen,1=visiting,2=done
+    stack.clear();
+    order.clear();
+    order.reserve(n);
+    size_t scanned = 0;
+    for (node_t root = 0; root < n; ++root) {
+        if (state[root] != 0) continue;
+        state[root] = 1;
+        stack.push_back(g.row_cursor(root));
+        while (!stack.empty()) {
+            DfsFrame &top = stack.back();
+            node_t v;
+            if (!g.next_neighbor(top, v)) {
+                state[top.node] = 2;
+                order.push_back(top.node);
+                stack.pop_back();
+                continue;
+            }
+            ++scanned;
+            if (state[v] == 1) {
+                TOPSORT_COUNT(kEdgesScanned, scanned);
+                return true;
+            }
+            if (state[v] == 0) {
+                state[v] = 1;
+                stack.push_back(g.row_cursor(v));
+            }
+        }
+    }
+    TOPSORT_COUNT(kEdgesScanned, scanned);
+    std::reverse(order.begin(), order.end());
+    return false;
+}
+
+// layer[v] = max(layer[u] + 1) over edges u->v, relaxed in topological order.
+template <class Graph>
+void layers(const Graph &g, const std::vector<node_t> &topo, std::vector<uint32_t> &layer) {
+    layer.assign(g.node_count(), 0);
+    for (node_t u : topo) {
+        uint32_t cand = layer[u] + 1;
+        g.for_each_neighbor(u, [&](node_t v) {
+            if (cand > layer[v]) layer[v] = cand;
+        });
+    }
+}
+
+// Passes that need row lengths up front or make several sweeps take a CsrView: free for CSR storage, one copy otherwise.
+inline CsrView to_csr(const CsrView &view) { return view; }
+
+template <class Graph>
+CsrView to_csr(const Graph &g) {
+    auto data = std::make_shared<CsrData>();
+    size_t n = g.node_count();
+    data->offsets.assign(n + 1, 0);
+    for (node_t u = 0; u < n; ++u) {
+        g.for_each_neighbor(u, [&](node_t v) { data->neighbors.push_back(v); });
+        data->offsets[u + 1] = static_cast<uint32_t>(data->neighbors.size());
+    }
+    return CsrView(std::move(data));
+}
+
+} // namespace kernels
+
+// Invoke fn with the most concrete graph type available so kernels are instantiated without virtual dispatch.
+// A CompressedGraph is read through a frozen CsrView snapshot (publishing pending edits first), so kernels see neither
+// the dirty check nor a concurrent rebuild; in compressed-only mode it is read through a VarintView instead.
+// Unknown GraphInterface implementations fall back to the virtual neighbor_span.
+template <class Fn>
+decltype(auto) visit_graph(const GraphInterface &g, Fn &&fn) {
+    if (auto *view = dynamic_cast<const CsrView *>(&g)) return fn(*view);
+    if (auto *vv = dynamic_cast<const VarintView *>(&g)) return fn(*vv);
+    if (auto *cg = dynamic_cast<const CompressedGraph *>(&g)) {
+        if (cg->compressed_only()) {
+            const VarintView view = cg->varint_view();
+            return fn(view);
+        }
+        const CsrView view = cg->snapshot();
+        return fn(view);
+    }
+    if (auto *mg = dynamic_cast<const MappedGraph *>(&g)) {
+        const CsrView view = mg->view();
+        return fn(view);
+    }
+    return fn(g);
+}
+
+// CsrView of any graph (see kernels::to_csr); a CompressedGraph yields its published snapshot without copying.
+inline CsrView csr_of(const GraphInterface &g) {
+    return visit_graph(g, [](const auto &cg) { return kernels::to_csr(cg); });
+}
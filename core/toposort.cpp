@@ -1,92 +1,226 @@
 #include "toposort.hpp"
+#include "output_writer.hpp"
+#include "parallel.hpp"
 
 #include <algorithm>
-#include <deque>
 #include <functional>
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <utility>
 
 std::vector<uint32_t> compute_indegrees(const GraphInterface &g) {
-    size_t n = g.node_count();
-    std::vector<uint32_t> indeg(n, 0);
-    for (uint32_t u = 0; u < n; ++u) {
-        auto span = g.neighbor_span(u);
-        for (auto it = span.first; it != span.second; ++it) indeg[*it]++;
-    }
+    TOPSORT_PHASE("indegrees");
+    std::vector<uint32_t> indeg;
+    visit_graph(g, [&](const auto &cg) { kernels::indegrees(cg, indeg); });
     return indeg;
 }
 
 bool DFSTopoSolver::run(std::vector<node_t> &order) {
-    size_t n = g_.node_count();
-    std::vector<uint8_t> state(n, 0); // 0=unseen,1=visiting,2=done
-    order.clear();
-    order.reserve(n);
-    bool has_cycle = false;
-    std::function<void(node_t)> dfs = [&](node_t u) {
-        state[u] = 1;
-        auto span = g_.neighbor_span(u);
-        for (auto it = span.first; it != span.second; ++it) {
-            node_t v = *it;
-            if (state[v] == 1) { has_cycle = true; return; }
-            if (state[v] == 0) dfs(v);
-            if (has_cycle) return;
-        }
-        state[u] = 2;
-        order.push_back(u);
-    };
-    for (node_t u = 0; u < n && !has_cycle; ++u) if (state[u] == 0) dfs(u);
-    if (!has_cycle) std::reverse(order.begin(), order.end());
-    return has_cycle;
+    TOPSORT_PHASE("solve/dfs");
+    return visit_graph(g_, [&](const auto &cg) { return kernels::dfs(cg, stack_, state_, order); });
 }
 
 bool KahnTopoSolver::run(std::vector<node_t> &order) {
-    size_t n = g_.node_count();
-    std::vector<uint32_t> indeg = compute_indegrees(g_);
-    std::deque<node_t> q;
-    for (node_t u = 0; u < n; ++u) if (indeg[u] == 0) q.push_back(u);
-    order.clear();
-    order.reserve(n);
-    while (!q.empty()) {
-        node_t u = q.front();
-        q.pop_front();
-        order.push_back(u);
-        auto span = g_.neighbor_span(u);
-        for (auto it = span.first; it != span.second; ++it) {
-            node_t v = *it;
-            if (--indeg[v] == 0) q.push_back(v);
-        }
-    }
-    return order.size() != n;
+    TOPSORT_PHASE("solve/kahn");
+    return visit_graph(g_, [&](const auto &cg) {
+        std::vector<uint32_t> indeg;
+        kernels::indegrees(cg, indeg);
+        return kernels::kahn(cg, indeg, order);
+    });
 }
 
 bool LexicographicKahnSolver::run(std::vector<node_t> &order) {
-    size_t n = g_.node_count();
-    std::vector<uint32_t> indeg = compute_indegrees(g_);
-    auto cmp = [&](node_t a, node_t b) { return min_first_ ? a > b : a < b; };
-    std::priority_queue<node_t, std::vector<node_t>, decltype(cmp)> pq(cmp);
-    for (node_t u = 0; u < n; ++u) if (indeg[u] == 0) pq.push(u);
+    TOPSORT_PHASE("solve/lexicographic");
+    return visit_graph(g_, [&](const auto &cg) {
+        std::vector<uint32_t> indeg;
+        kernels::indegrees(cg, indeg);
+        if (min_first_) return kernels::bitset_lexicographic_kahn<true>(cg, indeg, order);
+        return kernels::bitset_lexicographic_kahn<false>(cg, indeg, order);
+    });
+}
+
+ParallelKahnSolver::ParallelKahnSolver(GraphInterface &g, size_t worker_count)
+    : TopoSortSolver(g), workers_(std::max<size_t>(1, worker_count)) {}
+
+namespace {
+// Frontier blocks claimed per fetch_add; small enough to balance skewed levels, large enough to amortize the atomic.
+constexpr size_t kParallelGrain = 64;
+// Levels narrower than this are processed on the leader thread; waking the pool costs more than it saves.
+constexpr size_t kParallelMinFrontier = 2048;
+constexpr size_t kParallelMinNodes = 4096;
+
+#ifndef TOPSORT_NO_THREADS
+// Frontiers are exactly the antichain levels; if level_offsets is given, their boundaries are recorded into it.
+template <class Graph>
+bool parallel_kahn(const Graph &g, size_t workers, std::vector<GraphInterface::node_t> &order,
+                   std::vector<uint32_t> *level_offsets = nullptr) {
+    using node_t = GraphInterface::node_t;
+    size_t n = g.node_count();
+
+    std::unique_ptr<std::atomic<uint32_t>[]> indeg(new std::atomic<uint32_t>[n]);
+    parallel_for(n, workers, [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) indeg[i].store(0, std::memory_order_relaxed);
+    });
+    parallel_for(n, workers, [&](size_t, size_t b, size_t e) {
+        for (size_t u = b; u < e; ++u) {
+            g.for_each_neighbor(static_cast<node_t>(u),
+                                [&](node_t v) { indeg[v].fetch_add(1, std::memory_order_relaxed); });
+        }
+    });
+
     order.clear();
-    order.reserve(n);
-    while (!pq.empty()) {
-        node_t u = pq.top();
-        pq.pop();
-        order.push_back(u);
-        auto span = g_.neighbor_span(u);
-        for (auto it = span.first; it != span.second; ++it) {
-            node_t v = *it;
-            if (--indeg[v] == 0) pq.push(v);
+    order.reserve(n); // frontier is a range of `order`; reserve keeps it from moving
+    for (node_t u = 0; u < n; ++u) if (indeg[u].load(std::memory_order_relaxed) == 0) order.push_back(u);
+
+    // Per-level shared state. Slice s covers frontier [cursor[s], slice_end[s]) and is drained via fetch_add.
+    std::vector<std::atomic<size_t>> cursor(workers);
+    std::vector<size_t> slice_end(workers, 0);
+    std::vector<std::vector<node_t>> local(workers);
+    std::vector<size_t> scanned(workers, 0); // each worker writes its slot once per level
+    const node_t *frontier = nullptr;
+    EpochSignal epoch; // workers park on it through runs of narrow levels
+    std::atomic<size_t> finished{0};
+    std::atomic<bool> stop{false};
+
+    auto drain = [&](size_t w) {
+        auto &out = local[w];
+        out.clear();
+        size_t edges = 0;
+        for (size_t k = 0; k < workers; ++k) {
+            size_t s = (w + k) % workers; // own slice first, then steal from the others
+            for (;;) {
+                size_t b = cursor[s].fetch_add(kParallelGrain, std::memory_order_relaxed);
+                if (b >= slice_end[s]) break;
+                size_t e = std::min(b + kParallelGrain, slice_end[s]);
+                for (size_t i = b; i < e; ++i) {
+                    g.for_each_neighbor(frontier[i], [&](node_t v) {
+                        ++edges;
+                        if (indeg[v].fetch_sub(1, std::memory_order_relaxed) == 1) out.push_back(v);
+                    });
+                }
+            }
         }
-    }
+        scanned[w] += edges;
+    };
+
+    auto lead = [&] {
+        size_t level_begin = 0;
+        if (level_offsets) level_offsets->assign(1, 0);
+        while (level_begin < order.size()) {
+            size_t level_end = order.size();
+            if (level_offsets) level_offsets->push_back(static_cast<uint32_t>(level_end));
+            size_t width = level_end - level_begin;
+            TOPSORT_LEVEL(width);
+            if (width < kParallelMinFrontier) {
+                for (size_t i = level_begin; i < level_end; ++i) {
+                    g.for_each_neighbor(order[i], [&](node_t v) {
+                        ++scanned[0];
+                        if (indeg[v].fetch_sub(1, std::memory_order_relaxed) == 1) order.push_back(v);
+                    });
+                }
+            } else {
+                frontier = order.data() + level_begin;
+                for (size_t s = 0; s < workers; ++s) {
+                    cursor[s].store(width * s / workers, std::memory_order_relaxed);
+                    slice_end[s] = width * (s + 1) / workers;
+                }
+                finished.store(0, std::memory_order_relaxed);
+                epoch.advance();
+                drain(0);
+                while (finished.load(std::memory_order_acquire) != workers - 1) cpu_relax();
+                for (const auto &buf : local) order.insert(order.end(), buf.begin(), buf.end());
+            }
+            level_begin = level_end;
+        }
+        stop.store(true, std::memory_order_relaxed);
+        epoch.advance();
+    };
+
+    run_workers(workers, [&](size_t w) {
+        if (w == 0) { lead(); return; }
+        uint64_t seen = 0;
+        for (;;) {
+            seen = epoch.wait_past(seen);
+            if (stop.load(std::memory_order_relaxed)) return;
+            drain(w);
+            finished.fetch_add(1, std::memory_order_release);
+        }
+    });
+    size_t total = 0;
+    for (size_t s : scanned) total += s;
+    TOPSORT_COUNT(kEdgesScanned, total);
     return order.size() != n;
 }
+#endif
+}
 
-ParallelKahnSolver::ParallelKahnSolver(GraphInterface &g, size_t worker_count)
+bool ParallelKahnSolver::run(std::vector<node_t> &order) {
+    TOPSORT_PHASE("solve/parallel_kahn");
+#ifdef TOPSORT_NO_THREADS
+    return KahnTopoSolver(g_).run(order);
+#else
+    if (workers_ <= 1 || g_.node_count() < kParallelMinNodes) return KahnTopoSolver(g_).run(order);
+    g_.neighbor_span(0); // let lazily-built storage materialize before worker threads read it
+    return visit_graph(g_, [&](const auto &cg) { return parallel_kahn(cg, workers_, order); });
+#endif
+}
+
+uint32_t TopoLevels::max_width() const {
+    uint32_t best = 0;
+    for (size_t k = 0; k < level_count(); ++k) best = std::max(best, width(k));
+    return best;
+}
+
+LayeredTopoSolver::LayeredTopoSolver(GraphInterface &g, size_t worker_count)
     : TopoSortSolver(g), workers_(std::max<size_t>(1, worker_count)) {}
 
-bool ParallelKahnSolver::run(std::vector<node_t> &order) {
-    // Fallback to sequential Kahn on platforms without std::thread support.
-    KahnTopoSolver fallback(g_);
-    return fallback.run(order);
+bool LayeredTopoSolver::run_levels(TopoLevels &levels) {
+    TOPSORT_PHASE("solve/layered");
+#ifndef TOPSORT_NO_THREADS
+    if (workers_ > 1 && g_.node_count() >= kParallelMinNodes) {
+        g_.neighbor_span(0); // let lazily-built storage materialize before worker threads read it
+        return visit_graph(g_, [&](const auto &cg) { return parallel_kahn(cg, workers_, levels.nodes, &levels.offsets); });
+    }
+#endif
+    return visit_graph(g_, [&](const auto &cg) {
+        std::vector<uint32_t> indeg;
+        kernels::indegrees(cg, indeg);
+        return kernels::kahn_levels(cg, indeg, levels.nodes, levels.offsets);
+    });
+}
+
+bool LayeredTopoSolver::run(std::vector<node_t> &order) {
+    TopoLevels levels;
+    bool has_cycle = run_levels(levels);
+    order = std::move(levels.nodes);
+    return has_cycle;
+}
+
+void write_levels_json(OutputWriter &w, const TopoLevels &levels) {
+    std::vector<uint32_t> widths(levels.level_count());
+    for (size_t k = 0; k < widths.size(); ++k) widths[k] = levels.width(k);
+    w.put("{\"level_offsets\":");
+    write_json_array(w, levels.offsets);
+    w.put(",\"level_nodes\":");
+    write_json_array(w, levels.nodes);
+    w.put(",\"level_widths\":");
+    write_json_array(w, widths);
+    w.put(",\"max_width\":");
+    w.put_uint(levels.max_width());
+    w.put(",\"critical_path\":");
+    w.put_uint(levels.critical_path());
+    w.put('}');
+}
+
+std::string levels_to_json(const TopoLevels &levels) {
+    TOPSORT_PHASE("json");
+    std::string out;
+    out.reserve((levels.offsets.size() + 2 * levels.nodes.size()) * 8 + 96);
+    OutputWriter w(out);
+    write_levels_json(w, levels);
+    w.flush();
+    return out;
 }
 
 IncrementalTopoSolver::IncrementalTopoSolver(CompressedGraph &g)
@@ -96,92 +230,364 @@ bool IncrementalTopoSolver::ensure_initialized() {
     if (!order_.empty()) return true;
     order_.clear();
     bool has_cycle = KahnTopoSolver(cg_).run(order_);
-    if (has_cycle) return false;
-    position_.assign(order_.size(), 0);
-    for (uint32_t i = 0; i < order_.size(); ++i) position_[order_[i]] = i;
+    if (has_cycle) {
+        order_.clear(); // Kahn leaves the acyclic prefix behind; an empty order_ means "not initialized"
+        return false;
+    }
+    size_t n = order_.size();
+    position_.assign(n, 0);
+    for (uint32_t i = 0; i < n; ++i) position_[order_[i]] = i;
+    holes_ = 0;
+    fwd_mark_.assign(n, 0);
+    bwd_mark_.assign(n, 0);
+    epoch_ = 0;
+    rebuild_preds();
     return true;
 }
 
-bool IncrementalTopoSolver::relabel_after_insertion(node_t u, node_t v) {
+void IncrementalTopoSolver::rebuild_preds() {
     size_t n = cg_.node_count();
-    std::vector<uint8_t> in_subgraph(n, 0);
-    std::deque<node_t> dq;
-    dq.push_back(v);
-    while (!dq.empty()) {
-        node_t x = dq.front();
-        dq.pop_front();
-        if (in_subgraph[x]) continue;
-        in_subgraph[x] = 1;
-        auto span = cg_.neighbor_span(x);
-        for (auto it = span.first; it != span.second; ++it) {
-            node_t w = *it;
-            if (position_[w] <= position_[u]) dq.push_back(w);
+    pred_offsets_.assign(n + 1, 0);
+    for (node_t u = 0; u < n; ++u) cg_.for_each_neighbor(u, [&](node_t v) { pred_offsets_[v + 1]++; });
+    for (size_t i = 0; i < n; ++i) pred_offsets_[i + 1] += pred_offsets_[i];
+    pred_nodes_.resize(pred_offsets_[n]);
+    std::vector<uint32_t> cursor(pred_offsets_.begin(), pred_offsets_.end() - 1);
+    for (node_t u = 0; u < n; ++u) cg_.for_each_neighbor(u, [&](node_t v) { pred_nodes_[cursor[v]++] = u; });
+    pred_added_.clear();
+    pred_added_count_ = 0;
+    pred_stale_ = 0;
+}
+
+void IncrementalTopoSolver::insert_edge(node_t u, node_t v) {
+    cg_.add_edge(u, v);
+    pred_added_[v].push_back(u); // a duplicate edge only costs a repeated (already marked) visit
+    ++pred_added_count_;
+    note_pred_change();
+}
+
+// Fold the overflow and stale entries back into the CSR once they are as large as the snapshot; amortized O(1) each.
+void IncrementalTopoSolver::note_pred_change() {
+    if (pred_added_count_ + pred_stale_ > std::max<size_t>(pred_nodes_.size(), cg_.node_count())) rebuild_preds();
+}
+
+// Delete every edge y->x and collect the y. Stale or repeated pred entries fail remove_edge and are skipped.
+void IncrementalTopoSolver::strip_in_edges(node_t x, std::vector<node_t> &preds) {
+    preds.clear();
+    auto take = [&](node_t y) {
+        if (y < cg_.node_count() && cg_.remove_edge(y, x)) preds.push_back(y);
+    };
+    for (uint32_t k = pred_offsets_[x]; k < pred_offsets_[x + 1]; ++k) take(pred_nodes_[k]);
+    auto extra = pred_added_.find(x);
+    if (extra != pred_added_.end()) {
+        for (node_t y : extra->second) take(y);
+        pred_added_count_ -= extra->second.size();
+        pred_added_.erase(extra);
+    }
+    pred_stale_ += preds.size();
+}
+
+void IncrementalTopoSolver::next_epoch() {
+    if (++epoch_ != 0) return;
+    std::fill(fwd_mark_.begin(), fwd_mark_.end(), 0);
+    std::fill(bwd_mark_.begin(), bwd_mark_.end(), 0);
+    epoch_ = 1;
+}
+
+// Pearce-Kelly for one edge u->v with position[v] < position[u]. F = nodes reachable from v below position[u],
+// B = nodes reaching u above position[v]; only they move. Their old slots are pooled and handed out to B then F,
+// each in old relative order, so B only moves earlier and F only later and every edge leaving the set stays valid.
+// Cost O(|F| + |B| + their edges + sort), independent of n. Returns false (changing nothing) if v reaches u.
+bool IncrementalTopoSolver::insert_backward(node_t u, node_t v) {
+    const uint32_t lb = position_[v], ub = position_[u];
+    next_epoch();
+
+    fwd_set_.clear();
+    stack_.assign(1, v);
+    fwd_mark_[v] = epoch_;
+    while (!stack_.empty()) {
+        node_t x = stack_.back();
+        stack_.pop_back();
+        fwd_set_.push_back(x);
+        bool cycle = false;
+        cg_.for_each_neighbor(x, [&](node_t y) {
+            uint32_t p = position_[y];
+            if (p == ub) cycle = true;
+            if (p < ub && fwd_mark_[y] != epoch_) {
+                fwd_mark_[y] = epoch_;
+                stack_.push_back(y);
+            }
+        });
+        if (cycle) return false;
+    }
+
+    bwd_set_.clear();
+    stack_.assign(1, u);
+    bwd_mark_[u] = epoch_;
+    const size_t n = cg_.node_count();
+    auto visit_pred = [&](node_t x, node_t y) {
+        if (pred_stale_ != 0 && (y >= n || !cg_.has_edge(y, x))) return;
+        if (position_[y] > lb && bwd_mark_[y] != epoch_) {
+            bwd_mark_[y] = epoch_;
+            stack_.push_back(y);
+        }
+    };
+    while (!stack_.empty()) {
+        node_t x = stack_.back();
+        stack_.pop_back();
+        bwd_set_.push_back(x);
+        for (uint32_t k = pred_offsets_[x]; k < pred_offsets_[x + 1]; ++k) visit_pred(x, pred_nodes_[k]);
+        auto extra = pred_added_.find(x);
+        if (extra != pred_added_.end()) for (node_t y : extra->second) visit_pred(x, y);
+    }
+
+    auto by_position = [&](node_t a, node_t b) { return position_[a] < position_[b]; };
+    std::sort(fwd_set_.begin(), fwd_set_.end(), by_position);
+    std::sort(bwd_set_.begin(), bwd_set_.end(), by_position);
+    slots_.clear();
+    for (node_t x : bwd_set_) slots_.push_back(position_[x]);
+    for (node_t x : fwd_set_) slots_.push_back(position_[x]);
+    std::inplace_merge(slots_.begin(), slots_.begin() + static_cast<std::ptrdiff_t>(bwd_set_.size()), slots_.end());
+    size_t k = 0;
+    for (node_t x : bwd_set_) {
+        position_[x] = slots_[k];
+        order_[slots_[k++]] = x;
+    }
+    for (node_t x : fwd_set_) {
+        position_[x] = slots_[k];
+        order_[slots_[k++]] = x;
+    }
+    TOPSORT_COUNT(kRelabels, 1);
+    TOPSORT_COUNT(kRelabelNodes, slots_.size());
+    TOPSORT_MAX(kMaxRelabel, slots_.size());
+    insert_edge(u, v);
+    return true;
+}
+
+// Is `to` reachable from `from` using graph edges and `extra` (indexed by window slot), staying inside [lo, hi]?
+bool IncrementalTopoSolver::window_reaches(node_t from, node_t to, uint32_t lo, uint32_t hi,
+                                           const std::vector<std::vector<node_t>> &extra) {
+    next_epoch();
+    stack_.assign(1, from);
+    fwd_mark_[from] = epoch_;
+    while (!stack_.empty()) {
+        node_t x = stack_.back();
+        stack_.pop_back();
+        if (x == to) return true;
+        auto visit = [&](node_t y) {
+            uint32_t p = position_[y];
+            if (p < lo || p > hi || fwd_mark_[y] == epoch_) return;
+            fwd_mark_[y] = epoch_;
+            stack_.push_back(y);
+        };
+        cg_.for_each_neighbor(x, visit);
+        for (node_t y : extra[position_[x] - lo]) visit(y);
+    }
+    return false;
+}
+
+// Kahn over order_[lo..hi] with the graph's edges plus `extra`; on success the result refills the window's live slots
+// in place (holes stay where they are).
+bool IncrementalTopoSolver::reorder_window(uint32_t lo, uint32_t hi, const std::vector<Edge> &extra) {
+    size_t w = hi - lo + 1;
+    size_t live = w;
+    auto slot = [&](node_t x) { return position_[x] - lo; };
+    auto inside = [&](node_t x) { return position_[x] >= lo && position_[x] <= hi; };
+
+    std::vector<uint32_t> extra_offsets(w + 1, 0);
+    for (const Edge &e : extra) extra_offsets[slot(e.first) + 1]++;
+    for (size_t i = 0; i < w; ++i) extra_offsets[i + 1] += extra_offsets[i];
+    std::vector<node_t> extra_dst(extra.size());
+    {
+        std::vector<uint32_t> cursor(extra_offsets.begin(), extra_offsets.end() - 1);
+        for (const Edge &e : extra) extra_dst[cursor[slot(e.first)]++] = e.second;
+    }
+
+    std::vector<uint32_t> indeg(w, 0);
+    for (size_t i = 0; i < w; ++i) {
+        if (order_[lo + i] == kHole) {
+            --live;
+            continue;
         }
+        cg_.for_each_neighbor(order_[lo + i], [&](node_t y) {
+            if (inside(y)) indeg[slot(y)]++;
+        });
+    }
+    for (node_t y : extra_dst) indeg[slot(y)]++;
+
+    std::vector<node_t> local;
+    local.reserve(live);
+    for (size_t i = 0; i < w; ++i) if (indeg[i] == 0 && order_[lo + i] != kHole) local.push_back(order_[lo + i]);
+    for (size_t head = 0; head < local.size(); ++head) {
+        node_t x = local[head];
+        uint32_t sx = slot(x);
+        auto release = [&](node_t y) {
+            if (inside(y) && --indeg[slot(y)] == 0) local.push_back(y);
+        };
+        cg_.for_each_neighbor(x, release);
+        for (uint32_t k = extra_offsets[sx]; k < extra_offsets[sx + 1]; ++k) release(extra_dst[k]);
     }
-    in_subgraph[u] = 1;
+    if (local.size() != live) return false; // cycle
 
-    std::vector<node_t> affected;
-    affected.reserve(n);
-    for (node_t i = 0; i < n; ++i) if (in_subgraph[i]) affected.push_back(i);
-    if (affected.empty()) return true;
+    for (size_t i = 0, k = 0; i < w; ++i) {
+        if (order_[lo + i] == kHole) continue;
+        order_[lo + i] = local[k];
+        position_[local[k++]] = static_cast<uint32_t>(lo + i);
+    }
+    TOPSORT_COUNT(kRelabels, 1);
+    TOPSORT_COUNT(kRelabelNodes, live);
+    TOPSORT_MAX(kMaxRelabel, live);
+    return true;
+}
+
+bool IncrementalTopoSolver::add_edge(node_t u, node_t v) {
+    std::vector<size_t> rejected;
+    Edge e{u, v};
+    return add_edges(&e, 1, rejected);
+}
+
+bool IncrementalTopoSolver::add_edges(const Edge *edges, size_t count, std::vector<size_t> &rejected) {
+    rejected.clear();
+    size_t n = cg_.node_count();
+    for (size_t i = 0; i < count; ++i) {
+        if (edges[i].first >= n || edges[i].second >= n) throw std::out_of_range("edge endpoint out of bounds");
+    }
+    if (!ensure_initialized()) {
+        for (size_t i = 0; i < count; ++i) rejected.push_back(i);
+        return count == 0;
+    }
 
-    std::unordered_map<node_t, size_t> idx;
-    idx.reserve(affected.size() * 2);
-    for (size_t i = 0; i < affected.size(); ++i) idx[affected[i]] = i;
+    // Consistent edges go straight in; the rest define the window [lo, hi].
+    std::vector<size_t> backward;
+    uint32_t lo = UINT32_MAX, hi = 0;
+    for (size_t i = 0; i < count; ++i) {
+        node_t u = edges[i].first, v = edges[i].second;
+        if (u == v) {
+            rejected.push_back(i);
+        } else if (position_[u] < position_[v]) {
+            insert_edge(u, v);
+        } else {
+            backward.push_back(i);
+            lo = std::min(lo, position_[v]);
+            hi = std::max(hi, position_[u]);
+        }
+    }
+    if (backward.empty()) return rejected.empty();
 
-    std::vector<uint32_t> indeg_local(affected.size(), 0);
-    for (node_t x : affected) {
-        auto span = cg_.neighbor_span(x);
-        for (auto it = span.first; it != span.second; ++it) {
-            node_t w = *it;
-            auto f = idx.find(w);
-            if (f != idx.end()) indeg_local[f->second]++;
+    if (backward.size() == 1 || hi - lo + 1 > kDenseBatchSlots * backward.size()) {
+        // Sparse batch: bounded per-edge searches touch far less than the combined window.
+        for (size_t i : backward) {
+            node_t u = edges[i].first, v = edges[i].second;
+            if (position_[u] < position_[v]) insert_edge(u, v); // an earlier edge already moved them into place
+            else if (!insert_backward(u, v)) rejected.push_back(i);
         }
+        std::sort(rejected.begin(), rejected.end());
+        return rejected.empty();
     }
 
-    std::deque<node_t> q;
-    for (node_t x : affected) if (indeg_local[idx[x]] == 0) q.push_back(x);
-    std::vector<node_t> local_order;
-    local_order.reserve(affected.size());
-    while (!q.empty()) {
-        node_t x = q.front();
-        q.pop_front();
-        local_order.push_back(x);
-        auto span = cg_.neighbor_span(x);
-        for (auto it = span.first; it != span.second; ++it) {
-            node_t w = *it;
-            auto f = idx.find(w);
-            if (f != idx.end()) {
-                if (--indeg_local[f->second] == 0) q.push_back(w);
+    // Dense batch: one Kahn pass over the combined window.
+    std::vector<Edge> accepted;
+    accepted.reserve(backward.size());
+    for (size_t i : backward) accepted.push_back(edges[i]);
+    if (!reorder_window(lo, hi, accepted)) {
+        // Some subset closes a cycle: decide edge by edge (in batch order) with reachability inside the window, which
+        // is exact because no path that leaves [lo, hi] can come back. Only hit when the batch is rejected in part.
+        accepted.clear();
+        std::vector<std::vector<node_t>> extra(hi - lo + 1);
+        for (size_t i : backward) {
+            node_t u = edges[i].first, v = edges[i].second;
+            if (window_reaches(v, u, lo, hi, extra)) {
+                rejected.push_back(i);
+            } else {
+                extra[position_[u] - lo].push_back(v);
+                accepted.push_back(edges[i]);
             }
         }
+        reorder_window(lo, hi, accepted); // acyclic by construction
+        std::sort(rejected.begin(), rejected.end());
     }
-    if (local_order.size() != affected.size()) return false; // cycle detected
+    for (const Edge &e : accepted) insert_edge(e.first, e.second);
+    return rejected.empty();
+}
 
-    std::vector<node_t> new_order;
-    new_order.reserve(n);
-    size_t anchor = order_.size();
-    for (node_t x : affected) anchor = std::min(anchor, static_cast<size_t>(position_[x]));
-    for (size_t i = 0; i < order_.size(); ++i) {
-        if (i == anchor) new_order.insert(new_order.end(), local_order.begin(), local_order.end());
-        node_t x = order_[i];
-        if (!in_subgraph[x]) new_order.push_back(x);
+bool IncrementalTopoSolver::remove_edge(node_t u, node_t v) {
+    if (!cg_.remove_edge(u, v)) return false;
+    if (!order_.empty()) {
+        ++pred_stale_; // left in the pred lists; filtered on read
+        note_pred_change();
     }
-    order_.swap(new_order);
-    position_.assign(n, 0);
-    for (uint32_t i = 0; i < order_.size(); ++i) position_[order_[i]] = i;
     return true;
 }
 
-bool IncrementalTopoSolver::add_edge(node_t u, node_t v) {
-    if (!ensure_initialized()) return false;
-    cg_.add_edge(u, v);
-    if (position_[u] < position_[v]) return true;
-    return relabel_after_insertion(u, v);
+IncrementalTopoSolver::node_t IncrementalTopoSolver::add_node() {
+    node_t x = cg_.add_node();
+    if (order_.empty()) return x; // not initialized (or cyclic): the next run() starts over
+    position_.push_back(static_cast<uint32_t>(order_.size()));
+    order_.push_back(x);
+    size_t n = cg_.node_count();
+    if (fwd_mark_.size() < n) {
+        fwd_mark_.resize(n, 0);
+        bwd_mark_.resize(n, 0);
+    }
+    if (pred_offsets_.size() < n + 1) pred_offsets_.push_back(pred_offsets_.back());
+    return x;
+}
+
+IncrementalTopoSolver::node_t IncrementalTopoSolver::remove_node(node_t u) {
+    if (u >= cg_.node_count()) throw std::out_of_range("node id out of bounds");
+    if (order_.empty()) return cg_.remove_node(u);
+    const node_t last = static_cast<node_t>(cg_.node_count() - 1);
+
+    // Strip in-edges through the pred lists so the graph never scans its rows. last's in-edges come back under id u.
+    std::vector<node_t> preds;
+    strip_in_edges(u, preds);
+    std::vector<node_t> moved_preds;
+    if (last != u) strip_in_edges(last, moved_preds);
+    // Out-edges of u and last stay behind in their targets' pred lists under ids that no longer mean the same node.
+    cg_.for_each_neighbor(u, [&](node_t) { ++pred_stale_; });
+    if (last != u) cg_.for_each_neighbor(last, [&](node_t) { ++pred_stale_; });
+    cg_.remove_node(u);
+
+    // Leave a hole in u's slot (trailing holes are dropped), then give last's slot the new id.
+    order_[position_[u]] = kHole;
+    ++holes_;
+    while (!order_.empty() && order_.back() == kHole) {
+        order_.pop_back();
+        --holes_;
+    }
+    if (last != u) {
+        position_[u] = position_[last];
+        order_[position_[u]] = u;
+        cg_.for_each_neighbor(u, [&](node_t v) {
+            pred_added_[v].push_back(u);
+            ++pred_added_count_;
+        });
+        for (node_t y : moved_preds) {
+            if (y != u) insert_edge(y, u); // an edge from u went with it
+        }
+    }
+    position_.pop_back();
+    if (holes_ > order_.size() / 2) compact_order();
+    note_pred_change();
+    return last;
+}
+
+// Squeeze the holes out of order_ (relative order kept, so it stays valid). O(n), amortized over the removals that
+// made the holes.
+void IncrementalTopoSolver::compact_order() {
+    if (holes_ == 0) return;
+    size_t k = 0;
+    for (node_t x : order_) {
+        if (x == kHole) continue;
+        position_[x] = static_cast<uint32_t>(k);
+        order_[k++] = x;
+    }
+    order_.resize(k);
+    holes_ = 0;
 }
 
 bool IncrementalTopoSolver::run(std::vector<node_t> &order) {
     if (!ensure_initialized()) return true;
+    compact_order();
     order = order_;
     return false;
 }
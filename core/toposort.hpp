@@ -1,12 +1,18 @@
 #pragma once
 
 #include "compressed_graph.hpp"
+#include "topo_kernels.hpp"
 
 #include <atomic>
 #include <memory>
 #include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+class OutputWriter;
+
 // Base class: all solvers return true when a cycle is found.
 class TopoSortSolver {
 public:
@@ -21,12 +27,17 @@ protected:
     GraphInterface &g_;
 };
 
-// DFS with three-color marking. Time O(n+m), space O(n).
+// DFS with three-color marking, iterative over an explicit stack of (node, edge cursor) frames so deep chains cannot
+// overflow the call stack. Emits the same order as the recursive formulation. Scratch buffers are kept across runs.
+// Time O(n+m), space O(n).
 class DFSTopoSolver : public TopoSortSolver {
 public:
     using TopoSortSolver::TopoSortSolver;
     bool run(std::vector<node_t> &order) override;
     const char *name() const override { return "dfs"; }
+private:
+    std::vector<kernels::DfsFrame> stack_;
+    std::vector<uint8_t> state_;
 };
 
 // Kahn queue-based solver. Time O(n+m), space O(n).
@@ -37,7 +48,8 @@ public:
     const char *name() const override { return "kahn"; }
 };
 
-// Lexicographic Kahn using a priority queue for min/max order. Time O((n+m) log n), space O(n).
+// Lexicographic Kahn: the smallest (or largest) ready id goes next. The frontier is a hierarchical bitset
+// (kernels::ReadySet), so the output matches a priority-queue Kahn exactly. Time O(n log64 n + m), space O(n).
 class LexicographicKahnSolver : public TopoSortSolver {
 public:
     LexicographicKahnSolver(GraphInterface &g, bool min_first) : TopoSortSolver(g), min_first_(min_first) {}
@@ -47,7 +59,12 @@ private:
     bool min_first_;
 };
 
-// Parallel Kahn: work-stealing via shared queue; thread-safe reads only. Time roughly O((n+m)/p + contention), space O(n).
+// Parallel Kahn: frontier-synchronous levels. Each worker owns a slice of the current zero-indegree frontier, claims
+// blocks from it, decrements indegrees atomically and collects newly-ready nodes in a private buffer; a worker whose
+// slice drains steals blocks from the other slices. Small frontiers run on the calling thread only; the other workers
+// spin briefly and then sleep until the next wide level (EpochSignal in parallel.hpp).
+// Output is level-by-level (a valid order; order within a level depends on scheduling). Reads only, so the graph must
+// not be mutated during run(). Time O((n+m)/p + L) for L levels, space O(n + p).
 class ParallelKahnSolver : public TopoSortSolver {
 public:
     ParallelKahnSolver(GraphInterface &g, size_t worker_count);
@@ -57,29 +74,116 @@ private:
     size_t workers_;
 };
 
+// Antichain levels of a DAG as a CSR: level k is nodes[offsets[k] .. offsets[k + 1]) and holds the nodes whose longest
+// incoming path has k edges, so every node depends only on earlier levels and a level can run fully in parallel.
+// nodes is a valid topological order. After a cycle, only the levels before the stall are present.
+struct TopoLevels {
+    std::vector<uint32_t> offsets{0}; // level_count() + 1 entries
+    std::vector<GraphInterface::node_t> nodes;
+
+    size_t level_count() const { return offsets.size() - 1; }
+    uint32_t width(size_t level) const { return offsets[level + 1] - offsets[level]; }
+    uint32_t max_width() const;
+    // Nodes on a longest dependency chain, i.e. the number of levels.
+    size_t critical_path() const { return level_count(); }
+};
+
+// Level-synchronous Kahn that emits TopoLevels directly, in one pass: levels are the frontiers of ParallelKahnSolver
+// when worker_count > 1 (and the graph is large enough), else the level-sorted runs of a FIFO Kahn. run() returns the
+// concatenated levels. Within a level the order is FIFO discovery order (a node follows the dequeue of its last
+// predecessor; level 0 alone is by id) in the sequential case and scheduling-dependent otherwise, so executors that
+// need a by-id dispatch must sort each level themselves.
+// Time O(n+m) (O((n+m)/p + L) in parallel), space O(n).
+class LayeredTopoSolver : public TopoSortSolver {
+public:
+    explicit LayeredTopoSolver(GraphInterface &g, size_t worker_count = 1);
+    bool run(std::vector<node_t> &order) override;
+    bool run_levels(TopoLevels &levels);
+    const char *name() const override { return "layered"; }
+private:
+    size_t workers_;
+};
+
+// JSON object with the level CSR and its summary:
+// {"level_offsets":[..],"level_nodes":[..],"level_widths":[..],"max_width":W,"critical_path":L}
+std::string levels_to_json(const TopoLevels &levels);
+// The same object streamed into w.
+void write_levels_json(OutputWriter &w, const TopoLevels &levels);
+
 // Incremental topological sort supporting edge insertions without full recompute.
-// Amortized time O(k + |E_s|) for subgraph size |E_s| touched by the violating edge; space O(n + m).
-// Proof sketch for correctness: (1) maintain invariant that order_ is a valid topological ordering; (2) on insertion u->v
-// where position[u] >= position[v], the BFS collects exactly the nodes reachable from v that violate the invariant;
-// (3) the local Kahn pass reorders only that induced subgraph, producing a valid order_ restricted to it; (4) splicing
-// the local order at the earliest affected position preserves precedence constraints for all unaffected nodes, hence the
-// resulting order_ is a topological order for the updated DAG.
+// An inserted edge u->v with position[u] < position[v] needs no work. Otherwise only the window of order_ between
+// position[v] and position[u] can change: nodes before it cannot be reached from v, and nodes after it cannot reach u
+// (any path leaving the window forward has no edge back into it).
+// Single edges and sparse batches use Pearce-Kelly: a forward search from v and a backward search from u, both bounded
+// by the window, collect the only nodes that must move, and they are reassigned among their own old positions. Cost is
+// proportional to that affected set and its edges, not to n or to the window. Dense batches (many backward edges in a
+// narrow window) instead re-sort the whole window once with Kahn. Search marks are epoch-stamped so no per-update
+// clearing is needed; a reverse adjacency is kept for the backward search. Space O(n + m).
 class IncrementalTopoSolver : public TopoSortSolver {
 public:
+    using Edge = std::pair<node_t, node_t>;
+
     explicit IncrementalTopoSolver(CompressedGraph &g);
     bool run(std::vector<node_t> &order) override; // runs/refreshes current order
     const char *name() const override { return "incremental"; }
 
-    // Returns true if no cycle introduced by the new edge.
+    // Returns true if the edge was inserted; an edge that would close a cycle is not inserted.
     bool add_edge(node_t u, node_t v);
+    // Insert a batch. Edges consistent with the current order are always accepted; any other edge that would close a
+    // cycle with the graph plus the edges accepted before it is skipped and its index appended to `rejected`. Returns
+    // true when every edge was inserted. Throws std::out_of_range (before inserting anything) on a bad endpoint.
+    bool add_edges(const Edge *edges, size_t count, std::vector<size_t> &rejected);
+    bool add_edges(const std::vector<Edge> &edges, std::vector<size_t> &rejected) {
+        return add_edges(edges.data(), edges.size(), rejected);
+    }
+    // Deleting edges and nodes never invalidates the order. remove_edge returns false if the edge was absent.
+    // remove_node follows CompressedGraph::remove_node (the last node takes id u) and costs the degrees of the two
+    // nodes, whatever u's position: u's slot becomes a hole that run() (or enough further holes) squeezes out in one
+    // O(n) pass. Before the first run() these just forward to the graph.
+    bool remove_edge(node_t u, node_t v);
+    node_t add_node();
+    node_t remove_node(node_t u);
+
 private:
+    // A batch takes the combined-window path when its window has at most this many slots per backward edge.
+    static constexpr size_t kDenseBatchSlots = 64;
+    // An order_ slot whose node was removed; positions of live nodes stay valid around it.
+    static constexpr node_t kHole = UINT32_MAX;
+
     bool ensure_initialized();
-    bool relabel_after_insertion(node_t u, node_t v);
+    void rebuild_preds();
+    void insert_edge(node_t u, node_t v);
+    void note_pred_change();
+    void strip_in_edges(node_t x, std::vector<node_t> &preds);
+    void compact_order();
+    void next_epoch();
+    bool insert_backward(node_t u, node_t v);
+    bool window_reaches(node_t from, node_t to, uint32_t lo, uint32_t hi,
+                        const std::vector<std::vector<node_t>> &extra);
+    bool reorder_window(uint32_t lo, uint32_t hi, const std::vector<Edge> &extra);
 
     CompressedGraph &cg_;
-    std::vector<node_t> order_;
+    std::vector<node_t> order_; // may hold kHole slots
     std::vector<uint32_t> position_;
+    size_t holes_{0};
+
+    // Reverse adjacency: CSR snapshot plus the edges inserted since, folded back in by rebuild_preds(). Deletions are
+    // lazy, so once pred_stale_ is nonzero an entry is only trusted after checking the edge still exists.
+    std::vector<uint32_t> pred_offsets_;
+    std::vector<node_t> pred_nodes_;
+    std::unordered_map<node_t, std::vector<node_t>> pred_added_;
+    size_t pred_added_count_{0};
+    size_t pred_stale_{0};
+
+    // Persistent search scratch. A node is marked in the current search iff its stamp equals epoch_.
+    std::vector<uint32_t> fwd_mark_;
+    std::vector<uint32_t> bwd_mark_;
+    uint32_t epoch_{0};
+    std::vector<node_t> stack_;
+    std::vector<node_t> fwd_set_;
+    std::vector<node_t> bwd_set_;
+    std::vector<uint32_t> slots_;
 };
 
-// Helper: compute indegrees from a graph view.
+// Helper: compute indegrees from a graph view (dispatches to kernels::indegrees on the concrete type).
 std::vector<uint32_t> compute_indegrees(const GraphInterface &g);
@@ -0,0 +1,138 @@
+#include "compressed_graph.hpp"
+
+#include <cstring>
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define TOPSORT_VARINT_SSE2 1
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+// One LEB128 value with the one- and two-byte cases peeled off; same contract as decode_varint32.
+inline uint32_t decode_one(const uint8_t *&p, const uint8_t *end) {
+    uint32_t b0 = p[0];
+    if (b0 < 0x80u) {
+        ++p;
+        return b0;
+    }
+    if (end - p >= 2 && p[1] < 0x80u) {
+        uint32_t value = (b0 & 0x7Fu) | (static_cast<uint32_t>(p[1]) << 7);
+        p += 2;
+        return value;
+    }
+    return decode_varint32(p, end);
+}
+
+#ifdef TOPSORT_VARINT_SSE2
+// Value of a varint of `len` bytes (1..5) starting at byte `start` of a 16-byte window held as two little-endian
+// words. Branch-free: shift the bytes down, squeeze out the continuation bits, and mask off what follows the value.
+inline uint32_t assemble(uint64_t lo, uint64_t hi, unsigned start, unsigned len) {
+    uint64_t x = start == 0 ? lo : start < 8 ? (lo >> (8 * start)) | (hi << (64 - 8 * start)) : hi >> (8 * (start - 8));
+    uint64_t v = (x & 0x7Full) | ((x >> 1) & 0x3F80ull) | ((x >> 2) & 0x1FC000ull) | ((x >> 3) & 0xFE00000ull) |
+                 ((x >> 4) & 0xF0000000ull);
+    uint64_t keep = len >= 5 ? 0xFFFFFFFFull : (1ull << (7 * len)) - 1;
+    return static_cast<uint32_t>(v & keep);
+}
+
+// Inclusive prefix sum of four u32 lanes plus a broadcast carry.
+inline __m128i prefix_sum4(__m128i x, __m128i carry) {
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+    return _mm_add_epi32(x, carry);
+}
+
+// 16 single-byte deltas -> 16 absolute ids. Returns the last id.
+inline uint32_t expand16(__m128i bytes, uint32_t base, uint32_t *out) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo16 = _mm_unpacklo_epi8(bytes, zero);
+    __m128i hi16 = _mm_unpackhi_epi8(bytes, zero);
+    __m128i carry = _mm_set1_epi32(static_cast<int>(base));
+    __m128i v0 = prefix_sum4(_mm_unpacklo_epi16(lo16, zero), carry);
+    carry = _mm_shuffle_epi32(v0, 0xFF);
+    __m128i v1 = prefix_sum4(_mm_unpackhi_epi16(lo16, zero), carry);
+    carry = _mm_shuffle_epi32(v1, 0xFF);
+    __m128i v2 = prefix_sum4(_mm_unpacklo_epi16(hi16, zero), carry);
+    carry = _mm_shuffle_epi32(v2, 0xFF);
+    __m128i v3 = prefix_sum4(_mm_unpackhi_epi16(hi16, zero), carry);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), v0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4), v1);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 8), v2);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 12), v3);
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_shuffle_epi32(v3, 0xFF)));
+}
+#endif
+}
+
+size_t decode_varint_deltas(const uint8_t *&p, const uint8_t *end, uint32_t base, uint32_t *out, size_t max_values,
+                            const uint8_t *limit) {
+    size_t count = 0;
+#ifdef TOPSORT_VARINT_SSE2
+    // Masked-VByte style: the high bits of a 16-byte window say where values end. A leading run of one-byte deltas is
+    // widened and prefix-summed in registers; a window that starts with a multi-byte value instead has every value that
+    // ends inside it (and before `end`) assembled from its known length, and the next window starts after the last one. Windows may reach past
+    // `end` up to `limit`, so short rows in a padded buffer take this path too.
+    if (limit == nullptr || limit < end) limit = end;
+    while (p < end && limit - p >= 16 && max_values - count >= 16) {
+        size_t avail = static_cast<size_t>(end - p);
+#if defined(__AVX2__)
+        if (avail >= 32 && max_values - count >= 32) {
+            __m256i wide = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            if (_mm256_movemask_epi8(wide) == 0) {
+                base = expand16(_mm256_castsi256_si128(wide), base, out + count);
+                base = expand16(_mm256_extracti128_si256(wide, 1), base, out + count + 16);
+                p += 32;
+                count += 32;
+                continue;
+            }
+        }
+#endif
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(block));
+        if (mask == 0 && avail >= 16) {
+            base = expand16(block, base, out + count);
+            p += 16;
+            count += 16;
+            continue;
+        }
+        unsigned valid = avail >= 16 ? 0xFFFFu : (1u << avail) - 1;
+        unsigned singles = static_cast<unsigned>(__builtin_ctz(mask | ~valid));
+        if (singles != 0) {
+            // Leading run of one-byte deltas: prefix-sum the whole window, keep the run (out has room for 16).
+            expand16(block, base, out + count);
+            count += singles;
+            p += singles;
+            base = out[count - 1];
+            continue;
+        }
+        // Each clear high bit before `end` terminates a value; decode every value completed inside this window.
+        unsigned ends = ~mask & valid;
+        if (ends == 0) break; // no terminator in reach (overlong or truncated value): leave it to the scalar loop
+        // Stop before a run of two or more one-byte values so the next window can take it vectorized.
+        unsigned one_byte = ends & (ends << 1);
+        unsigned runs = one_byte & (one_byte >> 1);
+        if (runs != 0) ends &= (1u << __builtin_ctz(runs)) - 1;
+        uint64_t lo, hi;
+        std::memcpy(&lo, p, 8);
+        std::memcpy(&hi, p + 8, 8);
+        unsigned start = 0;
+        do {
+            unsigned stop = static_cast<unsigned>(__builtin_ctz(ends));
+            ends &= ends - 1;
+            base += assemble(lo, hi, start, stop - start + 1);
+            out[count++] = base;
+            start = stop + 1;
+        } while (ends != 0);
+        p += start;
+    }
+#else
+    (void)limit;
+#endif
+    while (p < end && count < max_values) {
+        base += decode_one(p, end);
+        out[count++] = base;
+    }
+    return count;
+}
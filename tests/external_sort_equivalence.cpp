@@ -0,0 +1,143 @@
+// ExternalTopoSorter must emit exactly KahnTopoSolver's order on the same graph (and the same partial order before the
+// stall on a cycle). Seeded random edge lists, with repeated edges and under a random id permutation, are written as
+// text and sorted with the smallest memory budget, so the run buffer spills many runs, merges take several passes and
+// the frontier queue spills to disk; small graphs also run with the default budget. Both run() and run_to_file() are
+// checked. Exit status 0 on success; the first mismatch is printed with its seed.
+
+#include "compressed_graph.hpp"
+#include "external_sort.hpp"
+#include "toposort.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+using node_t = GraphInterface::node_t;
+using Edge = std::pair<node_t, node_t>;
+
+struct Failure : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+void check(bool ok, const std::string &what) {
+    if (!ok) throw Failure(what);
+}
+
+// m edges forward in a random ranking of the ids (about one in eight repeated), plus `back` edges against it.
+std::vector<Edge> random_edges(std::mt19937_64 &rng, size_t n, size_t m, size_t back) {
+    std::vector<node_t> rank(n);
+    std::iota(rank.begin(), rank.end(), 0);
+    std::shuffle(rank.begin(), rank.end(), rng);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    std::vector<Edge> edges;
+    for (size_t i = 0; i < m; ++i) {
+        if (!edges.empty() && rng() % 8 == 0) {
+            edges.push_back(edges[rng() % edges.size()]);
+            continue;
+        }
+        size_t a = pick(rng), b = pick(rng);
+        if (a == b) continue;
+        if (a > b) std::swap(a, b);
+        edges.push_back({rank[a], rank[b]});
+    }
+    for (size_t i = 0; i < back && !edges.empty(); ++i) {
+        Edge e = edges[rng() % edges.size()];
+        edges.push_back({e.second, e.first});
+    }
+    return edges;
+}
+
+std::string edge_list_text(size_t n, const std::vector<Edge> &edges) {
+    std::string s = std::to_string(n) + " " + std::to_string(edges.size()) + "\n";
+    for (const Edge &e : edges) s += std::to_string(e.first) + " " + std::to_string(e.second) + "\n";
+    return s;
+}
+
+using FilePtr = ExternalTopoSorter::FilePtr;
+
+std::vector<node_t> read_ids(const std::string &path) {
+    FilePtr f(std::fopen(path.c_str(), "rb"));
+    check(f != nullptr, "cannot reopen " + path);
+    std::vector<node_t> ids;
+    unsigned long v;
+    while (std::fscanf(f.get(), "%lu", &v) == 1) ids.push_back(static_cast<node_t>(v));
+    return ids;
+}
+
+// Returns the sorter's stats so the caller can check which paths were taken.
+ExternalSortStats check_graph(size_t n, const std::vector<Edge> &edges, size_t memory_bytes, const std::string &out_path) {
+    CompressedGraph g;
+    g.build_from_edges(n, edges);
+    std::vector<node_t> want;
+    bool want_cycle = KahnTopoSolver(g).run(want);
+
+    FilePtr in(std::tmpfile());
+    check(in != nullptr, "cannot create a temp input file");
+    std::string text = edge_list_text(n, edges);
+    check(std::fwrite(text.data(), 1, text.size(), in.get()) == text.size(), "cannot write the temp input file");
+    std::rewind(in.get());
+
+    ExternalSortOptions opt;
+    opt.memory_bytes = memory_bytes;
+    ExternalTopoSorter sorter(opt);
+    std::string err;
+    check(sorter.load_edge_list(in.get(), err), "load_edge_list failed: " + err);
+    std::vector<node_t> got;
+    bool got_cycle = false;
+    check(sorter.run(got, got_cycle, err), "run failed: " + err);
+    check(got_cycle == want_cycle, "cycle status differs from KahnTopoSolver");
+    check(got == want, "order differs from KahnTopoSolver");
+
+    bool file_cycle = false;
+    check(sorter.run_to_file(out_path, file_cycle, err), "run_to_file failed: " + err);
+    check(file_cycle == want_cycle && read_ids(out_path) == want, "run_to_file differs from KahnTopoSolver");
+    return sorter.stats();
+}
+} // namespace
+
+int main() {
+    struct Config {
+        size_t n, m;
+        size_t memory_bytes; // 0: the smallest budget the sorter allows
+    };
+    // The 0-budget configs hold about 16K edges per run and merge at most 3 runs per pass; the 200K-node one has a
+    // frontier of over 100K ids, far past the 16K-id queue block.
+    const Config configs[] = {
+        {1, 0, 0}, {40, 100, ExternalSortOptions{}.memory_bytes}, {2000, 8000, ExternalSortOptions{}.memory_bytes},
+        {50000, 250000, 0}, {200000, 120000, 0}};
+    const std::string out_path = "external_sort_equivalence.out"; // in the working directory (ctest: the build tree)
+    size_t runs = 0;
+    bool multi_pass = false;
+    try {
+        for (uint64_t seed = 1; seed <= 2; ++seed) {
+            for (const Config &c : configs) {
+                for (size_t back : {size_t(0), size_t(2)}) {
+                    std::mt19937_64 rng(seed * 104729 + c.n);
+                    std::vector<Edge> edges = random_edges(rng, c.n, c.m, back);
+                    try {
+                        ExternalSortStats st = check_graph(c.n, edges, c.memory_bytes, out_path);
+                        multi_pass = multi_pass || st.merge_passes > 2;
+                    } catch (const Failure &f) {
+                        throw Failure(std::string(f.what()) + " (seed " + std::to_string(seed) + ", n " +
+                                      std::to_string(c.n) + (back ? ", cyclic)" : ", acyclic)"));
+                    }
+                    ++runs;
+                }
+            }
+        }
+        check(multi_pass, "no graph needed more than one intermediate merge pass");
+    } catch (const Failure &f) {
+        std::remove(out_path.c_str());
+        std::fprintf(stderr, "FAIL: %s\n", f.what());
+        return 1;
+    }
+    std::remove(out_path.c_str());
+    std::printf("external_sort_equivalence: %zu graphs passed\n", runs);
+    return 0;
+}